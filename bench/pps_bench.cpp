@@ -0,0 +1,432 @@
+#include <frontend/lexer.h>
+#include <frontend/parser.h>
+#include <pipeline/evaluator.h>
+
+#include <pps/engine.h>
+#include <pps/pps.h>
+#include <pps/stats.h>
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Shape of a synthetic corpus
+struct CorpusOptions
+{
+    size_t lines         = 20000; // Lines of the main source
+    double density       = 0.2;   // Fraction of lines that are directives
+    int    depth         = 4;     // Maximum nesting of static branches
+    int    fanout        = 0;     // Includes per file
+    int    include_depth = 2;     // Levels of the include tree
+    int    variables     = 16;    // Distinct boolean variables
+};
+
+struct BenchOptions
+{
+    CorpusOptions corpus;
+    size_t        permutations = 256;
+    double        min_time     = 0.2;
+    bool          scale        = false;
+};
+
+// Generated source with the branch conditions it contains
+struct Corpus
+{
+    std::string              source;
+    std::vector<std::string> expressions;
+    fs::path                 include_dir;
+};
+
+static std::string genCondition(std::mt19937& rng, int variables)
+{
+    auto var = [&]() { return "@b" + std::to_string(rng() % variables); };
+    switch (rng() % 4)
+    {
+        case 0:
+            return var();
+        case 1:
+            return var() + " && " + var();
+        case 2:
+            return "!" + var() + " || @quality == " + std::to_string(rng() % 3);
+        default:
+            return "(" + var() + " || " + var() + ") && @quality != 1";
+    }
+}
+
+// Lines of code with balanced static branches nested up to `depth`
+static void genBody(std::mt19937& rng, const CorpusOptions& options, size_t lines, std::string& out, std::vector<std::string>* expressions)
+{
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    std::vector<bool> open_else;
+    for (size_t i = 0; i < lines; i++)
+    {
+        if (chance(rng) >= options.density)
+        {
+            out += std::string(open_else.size() * 4, ' ') + "color.rgb *= texture(map" + std::to_string(i % 7) + ", uv * " + std::to_string(i % 13) + ".0).rgb;\n";
+            continue;
+        }
+
+        auto condition = genCondition(rng, options.variables);
+        bool can_open  = int(open_else.size()) < options.depth;
+        auto action    = open_else.empty() ? 0 : rng() % 3;
+        if (action == 0 && can_open)
+        {
+            out += "/*<$static if " + condition + ">*/\n";
+            open_else.push_back(false);
+        }
+        else if (action == 1 && !open_else.back())
+        {
+            out += "/*<$static elif " + condition + ">*/\n";
+        }
+        else if (!open_else.empty())
+        {
+            if (!open_else.back() && rng() % 2)
+            {
+                out += "/*<$static else>*/\n";
+                open_else.back() = true;
+                continue;
+            }
+            out += "/*<$static endif>*/\n";
+            open_else.pop_back();
+            continue;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (expressions)
+            expressions->push_back(condition);
+    }
+
+    while (!open_else.empty())
+    {
+        out += "/*<$static endif>*/\n";
+        open_else.pop_back();
+    }
+}
+
+// Include tree of `fanout` files per level, each with a small body of its own
+static void genIncludes(std::mt19937& rng, const CorpusOptions& options, const fs::path& dir, const std::string& name, int level, std::string& includer)
+{
+    if (level > options.include_depth)
+        return;
+
+    for (int i = 0; i < options.fanout; i++)
+    {
+        auto        file = name + "_" + std::to_string(i) + ".hlsl";
+        std::string content;
+        genIncludes(rng, options, dir, name + "_" + std::to_string(i), level + 1, content);
+        genBody(rng, options, 64, content, nullptr);
+
+        std::ofstream(dir / file, std::ios::binary) << content;
+        includer += "/*<$include " + file + ">*/\n";
+    }
+}
+
+static Corpus genCorpus(const CorpusOptions& options)
+{
+    std::mt19937 rng(1);
+    Corpus       corpus;
+
+    if (options.fanout > 0)
+    {
+        corpus.include_dir = fs::temp_directory_path() / "pps_bench";
+        fs::remove_all(corpus.include_dir);
+        fs::create_directories(corpus.include_dir);
+        genIncludes(rng, options, corpus.include_dir, "inc", 1, corpus.source);
+    }
+
+    genBody(rng, options, options.lines, corpus.source, &corpus.expressions);
+    return corpus;
+}
+
+static pps::Context genContext(const CorpusOptions& options, uint32_t seed, const Corpus& corpus)
+{
+    pps::Context ctx;
+    for (int i = 0; i < options.variables; i++)
+        ctx.bools["@b" + std::to_string(i)] = ((seed >> (i % 32)) & 1) != 0;
+    ctx.ints["@quality"] = int(seed % 3);
+    if (!corpus.include_dir.empty())
+        ctx.prefixes.insert(corpus.include_dir.generic_string() + "/");
+    return ctx;
+}
+
+// Seconds per call, repeating until `min_time` has passed
+static double measure(double min_time, const std::function<void()>& func)
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t iterations = 0;
+    auto   start      = Clock::now();
+    double elapsed    = 0.0;
+    do
+    {
+        func();
+        iterations++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < min_time);
+
+    return elapsed / double(iterations);
+}
+
+static size_t countNodes(const pps::Node* node)
+{
+    if (node == nullptr)
+        return 0;
+
+    switch (node->type())
+    {
+        case pps::NodeType::tOp_binary:
+        {
+            auto binary = static_cast<const pps::BinaryOpNode*>(node);
+            return 1 + countNodes(binary->left.get()) + countNodes(binary->right.get());
+        }
+        case pps::NodeType::tOp_unary:
+            return 1 + countNodes(static_cast<const pps::UnaryOpNode*>(node)->child.get());
+        default:
+            return 1;
+    }
+}
+
+static void report(const char* bench, const CorpusOptions& corpus, double rate, const char* unit, double seconds)
+{
+    std::cout << "{\"bench\": \"" << bench << "\", \"lines\": " << corpus.lines << ", \"density\": " << corpus.density
+              << ", \"depth\": " << corpus.depth << ", \"fanout\": " << corpus.fanout << ", \"include_depth\": " << corpus.include_depth
+              << ", \"rate\": " << rate << ", \"unit\": \"" << unit << "\", \"seconds\": " << seconds << "}" << std::endl;
+}
+
+static void benchFrontend(const BenchOptions& options, const Corpus& corpus)
+{
+    const auto& expressions = corpus.expressions;
+    if (expressions.empty())
+        return;
+
+    std::vector<std::pmr::vector<pps::Token>> tokens;
+    size_t                                    token_count = 0;
+    for (const auto& expr : expressions)
+    {
+        pps::Lexer lexer(expr);
+        tokens.push_back(lexer.tokenize());
+        token_count += tokens.back().size();
+    }
+
+    auto lex_time = measure(options.min_time, [&]() {
+        for (const auto& expr : expressions)
+        {
+            pps::Lexer lexer(expr);
+            lexer.tokenize();
+        }
+    });
+    report("lexer", options.corpus, token_count / lex_time, "tokens/s", lex_time);
+
+    std::vector<std::unique_ptr<pps::Node>> roots;
+    size_t                                  node_count = 0;
+    for (const auto& list : tokens)
+    {
+        pps::Parser parser(list);
+        roots.push_back(parser.parse());
+        node_count += countNodes(roots.back().get());
+    }
+
+    auto parse_time = measure(options.min_time, [&]() {
+        for (const auto& list : tokens)
+        {
+            pps::Parser parser(list);
+            parser.parse();
+        }
+    });
+    report("parser", options.corpus, node_count / parse_time, "nodes/s", parse_time);
+
+    auto ctx       = genContext(options.corpus, 0x5bd1e995, corpus);
+    auto eval_time = measure(options.min_time, [&]() {
+        for (const auto& root : roots)
+        {
+            pps::Evaluator evaluator(&ctx.bools, &ctx.ints, &ctx.strings);
+            evaluator.evaluate(root.get());
+        }
+    });
+    report("evaluator", options.corpus, roots.size() / eval_time, "evaluations/s", eval_time);
+}
+
+static double benchProcess(const BenchOptions& options, const Corpus& corpus)
+{
+    auto     ctx = genContext(options.corpus, 0x5bd1e995, corpus);
+    pps::PPS lang;
+
+    auto time = measure(options.min_time, [&]() { lang.process(corpus.source, &ctx); });
+    report("process", options.corpus, corpus.source.size() / time / (1 << 20), "MB/s", time);
+    return time;
+}
+
+// Same call with the top-level regions processed concurrently
+static void benchParallel(const BenchOptions& options, const Corpus& corpus)
+{
+    auto        ctx = genContext(options.corpus, 0x5bd1e995, corpus);
+    pps::Engine engine;
+    engine.set_parallel_threshold(1);
+    pps::Session session(engine);
+
+    auto time = measure(options.min_time, [&]() { session.process(corpus.source, &ctx); });
+    report("process_parallel", options.corpus, corpus.source.size() / time / (1 << 20), "MB/s", time);
+}
+
+// Allocations of one call per stage; all zero unless libpps tracks allocations
+static void benchAllocations(const BenchOptions& options, const Corpus& corpus)
+{
+    auto       ctx = genContext(options.corpus, 0x5bd1e995, corpus);
+    pps::Stats stats;
+    pps::PPS   lang;
+    lang.set_stats(&stats);
+    lang.process(corpus.source, &ctx);
+
+    auto lines = double(std::max<uint64_t>(stats.lines, 1));
+    for (size_t i = 0; i < size_t(pps::Stage::tCount); i++)
+    {
+        const auto& stage = stats.stages[i];
+        std::cout << "{\"bench\": \"allocations\", \"stage\": \"" << pps::Stats::name(pps::Stage(i)) << "\", \"allocations\": " << stage.allocations
+                  << ", \"bytes\": " << stage.allocated_bytes << ", \"per_line\": " << stage.allocations / lines << "}" << std::endl;
+    }
+    std::cout << "{\"bench\": \"allocations\", \"stage\": \"total\", \"allocations\": " << stats.allocations
+              << ", \"bytes\": " << stats.allocated_bytes << ", \"per_line\": " << stats.allocations / lines
+              << ", \"tracking\": " << (stats.allocations ? "true" : "false") << "}" << std::endl;
+}
+
+static void benchPermutations(const BenchOptions& options, const Corpus& corpus)
+{
+    std::vector<pps::Context>  contexts;
+    std::vector<pps::Context*> pointers;
+    for (size_t i = 0; i < options.permutations; i++)
+        contexts.push_back(genContext(options.corpus, uint32_t(i * 2654435761u), corpus));
+    for (auto& ctx : contexts)
+        pointers.push_back(&ctx);
+
+    pps::PPS lang;
+    auto     batch_time = measure(options.min_time, [&]() { lang.process(corpus.source, pointers); });
+    report("permutations_batch", options.corpus, contexts.size() / batch_time, "permutations/s", batch_time);
+
+    auto loop_time = measure(options.min_time, [&]() {
+        for (auto ctx : pointers)
+            lang.process(corpus.source, ctx);
+    });
+    report("permutations_loop", options.corpus, contexts.size() / loop_time, "permutations/s", loop_time);
+}
+
+// Doubles one parameter at a time; an exponent well above 1 is superlinear
+static void benchScaling(BenchOptions options)
+{
+    struct Axis
+    {
+        const char*                name;
+        std::function<void(int)>   apply;
+        std::function<double(int)> size;
+        int                        steps;
+    };
+
+    auto base = options.corpus;
+
+    std::vector<Axis> axes = {
+        {"lines", [&](int step) { options.corpus.lines = base.lines << step; }, [&](int step) { return double(base.lines << step); }, 4},
+        {"depth", [&](int step) { options.corpus.depth = 1 << step; options.corpus.density = 0.5; }, [&](int step) { return double(1 << step); }, 6},
+        {"include_depth", [&](int step) { options.corpus.fanout = 2; options.corpus.include_depth = step + 1; options.corpus.lines = 0; },
+         [&](int step) { return std::pow(2.0, step + 2) - 2; }, 6},
+    };
+
+    for (auto& axis : axes)
+    {
+        double last_time = 0.0;
+        double last_size = 0.0;
+        for (int step = 0; step < axis.steps; step++)
+        {
+            options.corpus = base;
+            axis.apply(step);
+
+            auto corpus = genCorpus(options.corpus);
+            auto time   = benchProcess(options, corpus);
+            auto size   = axis.size(step);
+            if (!corpus.include_dir.empty())
+                fs::remove_all(corpus.include_dir);
+            if (last_time > 0.0)
+            {
+                auto exponent = std::log(time / last_time) / std::log(size / last_size);
+                std::cout << "{\"bench\": \"scaling\", \"axis\": \"" << axis.name << "\", \"size\": " << size
+                          << ", \"exponent\": " << exponent << ", \"superlinear\": " << (exponent > 1.3 ? "true" : "false") << "}" << std::endl;
+            }
+            last_time = time;
+            last_size = size;
+        }
+    }
+}
+
+static void showUsage()
+{
+    std::cout << "Usage: pps_bench [options]\n"
+              << "  --lines <N>          Lines of the main source (default 20000)\n"
+              << "  --density <0..1>     Fraction of directive lines (default 0.2)\n"
+              << "  --depth <N>          Maximum branch nesting (default 4)\n"
+              << "  --fanout <N>         Includes per file (default 0)\n"
+              << "  --include-depth <N>  Levels of the include tree (default 2)\n"
+              << "  --permutations <N>   Contexts of the permutation benchmark (default 256)\n"
+              << "  --min-time <s>       Minimum time per measurement (default 0.2)\n"
+              << "  --scale              Double each parameter and report the growth exponent" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg   = argv[i];
+        bool        value = i + 1 < argc;
+
+        if (arg == "--lines" && value)
+            options.corpus.lines = std::stoul(argv[++i]);
+        else if (arg == "--density" && value)
+            options.corpus.density = std::stod(argv[++i]);
+        else if (arg == "--depth" && value)
+            options.corpus.depth = std::stoi(argv[++i]);
+        else if (arg == "--fanout" && value)
+            options.corpus.fanout = std::stoi(argv[++i]);
+        else if (arg == "--include-depth" && value)
+            options.corpus.include_depth = std::stoi(argv[++i]);
+        else if (arg == "--permutations" && value)
+            options.permutations = std::stoul(argv[++i]);
+        else if (arg == "--min-time" && value)
+            options.min_time = std::stod(argv[++i]);
+        else if (arg == "--scale")
+            options.scale = true;
+        else
+        {
+            showUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (options.scale)
+    {
+        benchScaling(options);
+        return 0;
+    }
+
+    auto corpus = genCorpus(options.corpus);
+    benchFrontend(options, corpus);
+    benchProcess(options, corpus);
+    benchParallel(options, corpus);
+    benchAllocations(options, corpus);
+    benchPermutations(options, corpus);
+
+    if (!corpus.include_dir.empty())
+        fs::remove_all(corpus.include_dir);
+    return 0;
+}
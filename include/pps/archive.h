@@ -0,0 +1,87 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <fstream>
+#include <mutex>
+
+namespace pps
+{
+
+// Archive layout, little endian:
+//   header  "PPSA", u32 version
+//   blobs   u64 size followed by the output; identical outputs are stored once
+//   index   ArchiveEntry[count] sorted by (low, high), 8-byte aligned
+//   footer  u64 index offset, u64 count, "PPSI", u32 version
+// Entries are keyed by the fingerprint of the context without its include
+// prefixes, so a runtime can look up a permutation from its variables alone.
+struct ArchiveEntry
+{
+    uint64_t low;
+    uint64_t high;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Appends outputs to a single archive file; add() can be called from several threads
+class PPS_API ArchiveWriter
+{
+    std::fstream              m_file;
+    uint64_t                  m_offset = 0;
+    std::vector<ArchiveEntry> m_index;
+    std::mutex                m_mutex;
+    uint64_t                  m_duplicates = 0;
+
+    // Content hash to the index entries holding that content
+    std::unordered_map<uint64_t, std::vector<size_t>> m_blobs;
+
+public:
+    ArchiveWriter() = default;
+    ~ArchiveWriter();
+
+    bool open(const std::string& path);
+
+    // False if the write failed. A context added twice keeps its first output and is
+    // reported by finish().
+    bool add(const Context& context, std::string_view output);
+    bool add(const Fingerprint& key, std::string_view output);
+
+    // Write the index and footer; the archive is unreadable until then
+    bool finish();
+
+    size_t   size() const { return m_index.size(); }
+    uint64_t duplicates() const { return m_duplicates; }
+
+private:
+    bool _same_blob(const ArchiveEntry& entry, std::string_view output);
+};
+
+// Memory-mapped archive reader; lookups are a binary search over the index
+class PPS_API ArchiveReader
+{
+    const char*         m_data   = nullptr;
+    size_t              m_size   = 0;
+    const ArchiveEntry* m_index  = nullptr;
+    uint64_t            m_count  = 0;
+    void*               m_handle = nullptr;
+
+public:
+    ArchiveReader() = default;
+    ~ArchiveReader();
+
+    ArchiveReader(const ArchiveReader&)            = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // The view stays valid until the reader is closed
+    bool find(const Context& context, std::string_view& output) const;
+    bool find(const Fingerprint& key, std::string_view& output) const;
+
+    size_t size() const { return m_count; }
+
+    static Fingerprint key(const Context& context);
+};
+
+} // namespace pps
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace pps
+{
+
+class IncludeProvider;
+struct CacheEntry;
+
+struct CacheStats
+{
+    uint64_t hits      = 0;
+    uint64_t misses    = 0;
+    uint64_t stores    = 0;
+    uint64_t evictions = 0;
+    uint64_t bytes     = 0;
+};
+
+// Content-addressed on-disk cache of processed outputs. The key covers the
+// source, the content of every resolved include and the context variables the
+// output actually read, so entries can be shared across machines and branches.
+// An entry is also only valid while the include candidates that were probed and
+// missed still do not exist. Files are written atomically; the directory is kept
+// under `max_bytes` by evicting the least recently used entries.
+class PPS_API Cache
+{
+    // Content hash of an included file, valid while its size and modification time stay
+    struct FileHash
+    {
+        std::filesystem::file_time_type time;
+        uintmax_t                       size = 0;
+        uint64_t                        hash = 0;
+    };
+
+    std::string m_directory;
+    uint64_t    m_max_bytes;
+
+    mutable std::shared_mutex                 m_hash_mutex;
+    std::unordered_map<std::string, FileHash> m_hashes;
+
+    std::atomic<uint64_t> m_bytes     = 0;
+    std::atomic<uint64_t> m_hits      = 0;
+    std::atomic<uint64_t> m_misses    = 0;
+    std::atomic<uint64_t> m_stores    = 0;
+    std::atomic<uint64_t> m_evictions = 0;
+
+public:
+    explicit Cache(const std::string& directory, uint64_t max_bytes = 1ull << 30);
+
+    // Find the output of `source` for `context`. On a hit the dependencies and
+    // missed candidates of the stored output are written to `dependencies` and
+    // `misses` when given. Dependencies are read back through `provider` when the
+    // output was made with one.
+    bool lookup(const std::string&        source,
+                const Context&            context,
+                sbin::Loader*             module_loader,
+                const std::string&        decrypt_key,
+                std::string&              output,
+                std::vector<std::string>* dependencies = nullptr,
+                IncludeProvider*          provider     = nullptr,
+                std::vector<std::string>* misses       = nullptr);
+
+    // Store an output with the variables it read, the files it included and the
+    // include candidates it probed that did not exist
+    void store(const std::string&              source,
+               const Context&                  context,
+               const std::vector<std::string>& reads,
+               const std::vector<std::string>& dependencies,
+               const std::vector<std::string>& misses,
+               sbin::Loader*                   module_loader,
+               const std::string&              decrypt_key,
+               const std::string&              output,
+               IncludeProvider*                provider = nullptr);
+
+    CacheStats stats() const;
+
+    // Remove least recently used entries until the directory fits `max_bytes`
+    void evict();
+
+private:
+    bool _entry_key(uint64_t           base,
+                    const Context&     context,
+                    const CacheEntry&  entry,
+                    IncludeProvider*   provider,
+                    sbin::Loader*      module_loader,
+                    const std::string& decrypt_key,
+                    uint64_t&          key);
+
+    // Files are hashed once per change; loader and provider content every time
+    bool _dependency_hash(const std::string& path, IncludeProvider* provider, sbin::Loader* module_loader, const std::string& decrypt_key, uint64_t& hash);
+};
+
+} // namespace pps
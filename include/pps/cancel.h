@@ -0,0 +1,69 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace pps
+{
+
+enum class CancelStatus : uint8_t
+{
+    tRunning,
+    tCancelled, // cancel() was called
+    tTimedOut,  // The deadline passed
+};
+
+// Aborts the calls it is attached to once cancelled or past its deadline. Calls check
+// it at every directive and inside long evaluations; any thread may cancel it or move
+// the deadline.
+class CancellationToken
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken() = default;
+
+    // Deadline `timeout` from now
+    explicit CancellationToken(Clock::duration timeout) { set_deadline(Clock::now() + timeout); }
+
+    void cancel() { m_cancelled = true; }
+
+    void set_deadline(Clock::time_point deadline) { m_deadline = deadline.time_since_epoch().count(); }
+
+    CancelStatus status() const
+    {
+        if (m_cancelled.load(std::memory_order_relaxed))
+            return CancelStatus::tCancelled;
+
+        auto deadline = m_deadline.load(std::memory_order_relaxed);
+        if (deadline != s_never && Clock::now().time_since_epoch().count() >= deadline)
+            return CancelStatus::tTimedOut;
+        return CancelStatus::tRunning;
+    }
+
+private:
+    static constexpr Clock::rep s_never = std::numeric_limits<Clock::rep>::max();
+
+    std::atomic<bool>       m_cancelled = false;
+    std::atomic<Clock::rep> m_deadline  = s_never;
+};
+
+// Thrown out of a call whose token was cancelled or timed out. The call has no output: a
+// string passed to process_into is left empty, but an OutputSink keeps what it received.
+class Cancelled : public std::runtime_error
+{
+    CancelStatus m_status;
+
+public:
+    explicit Cancelled(CancelStatus status) :
+        std::runtime_error(status == CancelStatus::tTimedOut ? "PPS call timed out" : "PPS call cancelled"), m_status(status) {}
+
+    CancelStatus status() const { return m_status; }
+};
+
+} // namespace pps
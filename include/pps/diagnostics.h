@@ -0,0 +1,105 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pps
+{
+
+enum class DiagnosticCode : uint16_t
+{
+    tIncludeNotFound,
+    tIncludeCycle,
+    tUndefinedVariable, // A variable neither the context nor a declaration defines
+    tMissingOverride,   // An override whose variable the context lacks
+    tInvalidVariableType,
+    tUnknownOperator,
+    tUnsupportedOperator, // An operator that dynamic conditions cannot express
+    tUnknownNode,
+    tUndefinedToken,
+    tInvalidNumber,
+    tUnterminatedString,
+    tSyntax,
+    tCount,
+};
+
+enum class Severity : uint8_t
+{
+    tWarning,
+    tError,
+};
+
+struct Diagnostic
+{
+    DiagnosticCode code     = DiagnosticCode::tCount;
+    Severity       severity = Severity::tError;
+    std::string    message;
+
+    // Resolved path of the include the directive is in, empty for the processed source
+    std::string file;
+    uint32_t    line = 0; // 1-based, 0 when the line is unknown
+
+    // Reports of the same code at the same location
+    uint32_t count = 1;
+};
+
+// Receives the diagnostics of PPS calls in place of the log. A sink is called from the
+// threads that run the calls, concurrently when it is shared.
+class PPS_API DiagnosticSink
+{
+public:
+    virtual ~DiagnosticSink() = default;
+
+    // Whether the message of `diagnostic`, which has none yet, is wanted; false skips formatting it
+    virtual bool accept(const Diagnostic& diagnostic) = 0;
+
+    // An accepted diagnostic with its message
+    virtual void report(Diagnostic diagnostic) = 0;
+};
+
+// Collects diagnostics once per code and location, counting repeats. At most `limit`
+// locations are kept per code; further ones are only counted. Safe to share between threads.
+class PPS_API Diagnostics : public DiagnosticSink
+{
+    mutable std::mutex m_mutex;
+    size_t             m_limit;
+    bool               m_messages = true;
+
+    std::vector<Diagnostic>                 m_entries;
+    std::unordered_map<std::string, size_t> m_index;
+    uint64_t                                m_counts[size_t(DiagnosticCode::tCount)] = {};
+    uint64_t                                m_kept[size_t(DiagnosticCode::tCount)]   = {};
+    uint64_t                                m_suppressed                             = 0;
+
+public:
+    explicit Diagnostics(size_t limit = 16) :
+        m_limit(limit) {}
+
+    // Keep codes and locations only; messages are then never formatted
+    void set_messages(bool messages);
+
+    bool accept(const Diagnostic& diagnostic) override;
+    void report(Diagnostic diagnostic) override;
+
+    // Kept diagnostics in the order they were first reported
+    std::vector<Diagnostic> entries() const;
+
+    // Reports of `code`, kept or not
+    uint64_t count(DiagnosticCode code) const;
+
+    // Reports dropped because their code had reached the limit
+    uint64_t suppressed() const;
+
+    void clear();
+
+    std::string to_json() const;
+
+    static const char* name(DiagnosticCode code);
+};
+
+} // namespace pps
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <vector>
+
+namespace pps
+{
+
+// Byte range of a source or an output
+struct Range
+{
+    size_t offset = 0;
+    size_t length = 0;
+};
+
+class IncrementalTask;
+
+// A processed source that keeps its per-line structure, so that an edit only
+// re-evaluates the lines it touches and the directives depending on them.
+class PPS_API Document
+{
+    IncrementalTask* m_task;
+
+public:
+    Document(const std::string& source, Context* context);
+
+    Document(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    ~Document();
+
+    Document(const Document&)            = delete;
+    Document& operator=(const Document&) = delete;
+
+    const std::string& source() const;
+
+    // Same as PPS::process on the current source
+    const std::string& output() const;
+
+    // Replace `length` bytes at `offset` of the source with `text`.
+    // Returns the range of the output that was rewritten.
+    Range edit(size_t offset, size_t length, const std::string& text);
+
+    // Re-evaluate the directives reading `variable` after it was changed in the context.
+    // Returns the ranges of the output that were rewritten, in order.
+    std::vector<Range> update(const std::string& variable);
+};
+
+} // namespace pps
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pps
+{
+
+// Source split into lines once, with the lines that hold no directive marked so
+// that sessions pass them through without scanning
+class PPS_API Template
+{
+public:
+    struct Line
+    {
+        size_t offset    = 0;
+        size_t size      = 0;
+        bool   directive = false;
+    };
+
+    explicit Template(std::string source);
+
+    const std::string& source() const { return m_source; }
+
+    const std::vector<Line>& lines() const { return m_lines; }
+
+    std::string_view line(size_t index) const;
+
+    // Paths of the include directives, in order of appearance without repeats
+    const std::vector<std::string>& includes() const { return m_includes; }
+
+    // Largest output processed from the template so far; calls reserve it up front
+    size_t output_hint() const { return m_output_hint.load(std::memory_order_relaxed); }
+
+    void record_output(size_t size) const;
+
+private:
+    std::string              m_source;
+    std::vector<Line>        m_lines;
+    std::vector<std::string> m_includes;
+
+    mutable std::atomic<size_t> m_output_hint = 0;
+};
+
+// Receives the output of a call line by line instead of as one string
+class PPS_API OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+
+    // Expected size of the whole output, before the first append; 0 when unknown
+    virtual void reserve(size_t /*size*/) {}
+
+    virtual void append(std::string_view piece) = 0;
+};
+
+class Task;
+class Cache;
+class FileCache;
+struct Stats;
+class Tracer;
+class Executor;
+class IncludeMemo;
+class IncludeProvider;
+class DiagnosticSink;
+class CancellationToken;
+
+// Configuration and caches shared by any number of sessions. Configure it before
+// handing it to other threads; afterwards it is only read, so sessions on different
+// threads never lock on it.
+class PPS_API Engine
+{
+    Cache*           m_cache       = nullptr;
+    FileCache*       m_files       = nullptr;
+    IncludeProvider* m_provider    = nullptr;
+    Stats*           m_stats       = nullptr;
+    Tracer*          m_tracer      = nullptr;
+    DiagnosticSink*  m_diagnostics = nullptr;
+    Executor*        m_executor    = nullptr;
+    size_t           m_parallel    = 0;
+    bool             m_once        = false;
+    bool             m_memo        = true;
+
+public:
+    // Look up and store outputs in `cache`; nullptr disables caching
+    void set_cache(Cache* cache);
+
+    // Read includes through a cache shared with other engines; nullptr reads from disk
+    void set_file_cache(FileCache* files);
+
+    // Resolve includes through `provider` alone, e.g. a ChainProvider of memory, loader and
+    // disk, instead of the context's prefixes and the loader; nullptr restores those
+    void set_include_provider(IncludeProvider* provider);
+
+    // Stats that the calls of every session without its own merge into when they return;
+    // nullptr falls back to the global stats, if any
+    void set_stats(Stats* stats);
+
+    // Tracer of every session without its own; nullptr falls back to the global tracer, if any
+    void set_tracer(Tracer* tracer);
+
+    // Report the diagnostics of every session without its own sink to `diagnostics`, e.g. a
+    // pps::Diagnostics; nullptr logs them through aclg
+    void set_diagnostics(DiagnosticSink* diagnostics);
+
+    // Run asynchronous calls and their include reads on `executor`; nullptr uses default_executor()
+    void set_executor(Executor* executor);
+
+    // Split sources of at least `bytes` at the lines where no branch is open and process
+    // the regions concurrently on the executor; 0 disables splitting
+    void set_parallel_threshold(size_t bytes);
+
+    // Expand every include at most once per call, as if each had /*<$pragma once>*/
+    void set_include_once(bool once);
+
+    // Reuse the processed body of an include within a call, including a batch, where the
+    // branch stack and the variables it reads are the same; on by default
+    void set_include_memo(bool memo);
+
+    Cache*           cache() const { return m_cache; }
+    FileCache*       file_cache() const { return m_files; }
+    IncludeProvider* include_provider() const { return m_provider; }
+    Stats*           stats() const { return m_stats; }
+    Tracer*          tracer() const { return m_tracer; }
+    DiagnosticSink*  diagnostics() const { return m_diagnostics; }
+    Executor*        executor() const { return m_executor; }
+    size_t           parallel_threshold() const { return m_parallel; }
+    bool             include_once() const { return m_once; }
+    bool             include_memo() const { return m_memo; }
+
+    // Scan `source` once for processing it with many contexts
+    std::shared_ptr<const Template> prepare(std::string source) const;
+};
+
+// State of the calls of one thread: the branch stack, prog sources and dependencies
+// of the running call. Cheap to create; a session is not reentrant, but any number
+// of sessions can share one engine.
+class PPS_API Session
+{
+    const Engine*   m_engine;
+    Task*           m_task;
+    IncludeMemo*    m_memo;
+    Stats*          m_stats       = nullptr;
+    Tracer*         m_tracer      = nullptr;
+    DiagnosticSink* m_diagnostics = nullptr;
+
+    const CancellationToken*   m_cancellation = nullptr;
+    std::pmr::memory_resource* m_memory       = nullptr;
+
+    std::vector<std::string> m_dependencies;
+    std::vector<std::string> m_misses;
+
+    // Size of the last output of a plain source, keyed by where the source was and its size
+    const char* m_hint_source = nullptr;
+    size_t      m_hint_size   = 0;
+    size_t      m_output_hint = 0;
+
+    std::string m_buffer;
+
+    // Copy of the base of the last layered context, with no layer applied between calls
+    std::shared_ptr<const Context> m_layer_base;
+    Context                        m_layer;
+
+public:
+    explicit Session(const Engine& engine);
+
+    ~Session();
+
+    Session(const Session&)            = delete;
+    Session& operator=(const Session&) = delete;
+
+    std::string process(const std::string& source, Context* context);
+
+    std::string process(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Lines that the template marked as plain are not scanned for directives again. The
+    // engine's include provider, if any, is asked to prefetch the template's includes.
+    std::string process(const Template& source, Context* context);
+
+    std::string process(const Template& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Replace the content of `output` with the result, reusing its capacity. The output size
+    // of earlier calls on the same source is reserved up front, so a loop over contexts
+    // allocates the output once. `output` is left empty when the call throws.
+    void process_into(std::string& output, const std::string& source, Context* context);
+
+    void process_into(std::string& output, const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    void process_into(std::string& output, const Template& source, Context* context);
+
+    void process_into(std::string& output, const Template& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Hand the output to `sink` line by line as it is produced, without building it whole
+    // (unless it goes through the output cache). A call that throws, when cancelled for
+    // instance, leaves the lines handed over so far in the sink.
+    void process_into(OutputSink& sink, const Template& source, Context* context);
+
+    void process_into(OutputSink& sink, const Template& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Process with a layered context. The session copies the base once and then only
+    // writes and restores the layer of each call, so sweeping the layers of one base
+    // does not copy it per permutation.
+    std::string process(const std::string& source, const LayeredContext& context);
+
+    std::string process(const std::string& source, const LayeredContext& context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    std::string process(const Template& source, const LayeredContext& context);
+
+    std::string process(const Template& source, const LayeredContext& context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    void process_into(std::string& output, const Template& source, const LayeredContext& context);
+
+    // Process on the engine's executor while the includes, nested ones too, are read
+    // concurrently ahead of the lines that need them. The loader must be thread-safe,
+    // and the session and `context` must not be used until the future is ready.
+    std::future<std::string> process_async(const std::string& source, Context* context);
+
+    std::future<std::string> process_async(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Generate one output per context, sharing the work of common decision prefixes
+    std::vector<std::string> process(const std::string& source, const std::vector<Context*>& contexts);
+
+    std::vector<std::string> process(const std::string& source, const std::vector<Context*>& contexts, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Resolve what the (partial) context binds and emit residual pps source for the rest
+    std::string specialize(const std::string& source, Context* context);
+
+    std::string specialize(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Accumulate the stage timings and counters of the following calls directly into
+    // `stats`; nullptr falls back to the engine's
+    void set_stats(Stats* stats);
+
+    // Report the slices of the following calls to `tracer`; nullptr falls back to the engine's
+    void set_tracer(Tracer* tracer);
+
+    // Report the diagnostics of the following calls to `diagnostics`; nullptr falls back to the engine's
+    void set_diagnostics(DiagnosticSink* diagnostics);
+
+    // Abort the following calls, batches too, with pps::Cancelled once `token` is cancelled
+    // or past its deadline; nullptr runs them to the end
+    void set_cancellation(const CancellationToken* token);
+
+    // Allocate the scratch objects of the following calls, the parsed expressions and their
+    // values, from `resource` instead of the heap. A monotonic buffer released after each call
+    // then frees them at once. The token vectors, the child vectors of nodes and the expression's
+    // own variables come from it too. Names and literals stay std::string on the heap, since the
+    // context's maps hold them as such, as do the task's line buffers and branch stack, which
+    // outlive a call's expressions. Only the calling thread uses it, so it needs no locking;
+    // helper threads of parallel regions keep the heap. nullptr uses the heap.
+    void set_memory_resource(std::pmr::memory_resource* resource);
+
+    // Resolved paths of the files included by the last call; loader-sourced ones as "@loader/<path>",
+    // ones from a MemoryProvider as "@memory/<path>"
+    const std::vector<std::string>& dependencies() const;
+
+    // Include candidates the last call probed that did not exist, in the same form; while none
+    // of them appears, the dependencies resolve to the same files
+    const std::vector<std::string>& misses() const;
+
+private:
+    // Reset the task for a new call and attach its context, stats and tracer
+    Tracer* _begin(Stats* stats, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Run `call` with the session's copy of the base, the layer of `context` applied
+    template <class Call>
+    auto _with_layer(const LayeredContext& context, Call&& call);
+
+    void _process(const std::string& source, const Template* prepared, std::string& output);
+
+    void _process(const std::string& source, const Template* prepared, OutputSink& sink);
+
+    // Run the lines through the task and hand the formatted ones to `sink`, limiting their
+    // enters piece by piece when `enters` is given; returns the bytes appended
+    size_t _process_lines(const std::string& source, const Template* prepared, OutputSink& sink, int* enters);
+
+    size_t _output_hint(const std::string& source, const Template* prepared) const;
+
+    void _record_output(const std::string& source, const Template* prepared, size_t size);
+
+    // Process top-level regions concurrently; false if the source does not split
+    bool _process_regions(const std::string& source, const Template* prepared, std::vector<std::string>& processed);
+
+    void _process_cached(const std::string& source, const Template* prepared, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key, std::string& output);
+
+    std::string _specialize(const std::string& source);
+};
+
+} // namespace pps
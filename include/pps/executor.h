@@ -0,0 +1,52 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pps
+{
+
+// Runs the jobs of asynchronous calls; implement it to run them on an engine's own job system
+class PPS_API Executor
+{
+public:
+    virtual ~Executor() = default;
+
+    // Run `job` soon on some thread; jobs may run in any order and must not be dropped
+    virtual void post(std::function<void()> job) = 0;
+};
+
+// Fixed set of threads taking jobs from one queue; the destructor runs the queued jobs first
+class PPS_API ThreadPool : public Executor
+{
+    std::mutex                        m_mutex;
+    std::condition_variable           m_ready;
+    std::deque<std::function<void()>> m_jobs;
+    std::vector<std::thread>          m_threads;
+    bool                              m_stopping = false;
+
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+
+    ~ThreadPool() override;
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void post(std::function<void()> job) override;
+
+private:
+    void _run();
+};
+
+// Pool that asynchronous calls use when their engine has no executor
+PPS_API Executor& default_executor();
+
+} // namespace pps
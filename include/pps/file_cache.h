@@ -0,0 +1,42 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace pps
+{
+
+// Thread-safe cache of file contents that PPS instances share, so that a batch
+// reads every include once. Missing files are cached too. A validating cache
+// checks the size and modification time on every read and reloads changed files,
+// for long-running processes that outlive edits.
+class PPS_API FileCache
+{
+    struct CachedFile
+    {
+        std::shared_ptr<const std::string> content;
+        std::filesystem::file_time_type    time;
+        uintmax_t                          size = 0;
+    };
+
+    mutable std::shared_mutex m_mutex;
+    bool                      m_validate;
+
+    std::unordered_map<std::string, CachedFile> m_files;
+
+public:
+    explicit FileCache(bool validate = false) :
+        m_validate(validate) {}
+
+    // Content of `path`, nullptr if it cannot be read. The same pointer is
+    // returned until the file changes.
+    std::shared_ptr<const std::string> read(const std::string& path);
+
+    void clear();
+};
+
+} // namespace pps
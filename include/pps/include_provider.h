@@ -0,0 +1,115 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <memory>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pps
+{
+
+class FileCache;
+
+// Content of a resolved include
+struct IncludeFile
+{
+    std::shared_ptr<const std::string> content;
+
+    // Reported as a dependency: a disk path, "@loader/<path>" or "@memory/<path>"
+    std::string path;
+};
+
+// Source of include contents for an engine, in place of the context's disk prefixes
+// and the loader. Implementations must be safe to call from several threads.
+class PPS_API IncludeProvider
+{
+public:
+    virtual ~IncludeProvider() = default;
+
+    // Resolve the include `path` against `prefixes` as this provider sees fit
+    virtual bool read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file) = 0;
+
+    // Hint that the includes `paths` will be read soon, to fetch them in one go
+    virtual void prefetch(const std::vector<std::string>& /*paths*/, const std::set<std::string>& /*prefixes*/) {}
+
+    // Content of a dependency this provider reported, for validating cached outputs
+    virtual bool read_dependency(const std::string& /*dependency*/, std::shared_ptr<const std::string>& /*content*/) { return false; }
+};
+
+// Immutable buffers registered by path, shared without copying. Looks up each
+// prefix joined with the path, then the path alone.
+class PPS_API MemoryProvider : public IncludeProvider
+{
+    mutable std::shared_mutex m_mutex;
+
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> m_files;
+
+public:
+    void add(const std::string& path, std::string content);
+
+    void add(const std::string& path, std::shared_ptr<const std::string> content);
+
+    void remove(const std::string& path);
+
+    bool read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file) override;
+
+    bool read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content) override;
+};
+
+// Files below the context's prefixes, read through `files` when given
+class PPS_API DiskProvider : public IncludeProvider
+{
+    FileCache* m_files;
+
+public:
+    explicit DiskProvider(FileCache* files = nullptr) :
+        m_files(files) {}
+
+    bool read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file) override;
+
+    // Loads the files into the file cache, if any
+    void prefetch(const std::vector<std::string>& paths, const std::set<std::string>& prefixes) override;
+
+    bool read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content) override;
+};
+
+// Shaders of an sbin module, by the path alone
+class PPS_API LoaderProvider : public IncludeProvider
+{
+    sbin::Loader* m_loader;
+    std::string   m_decrypt_key;
+
+public:
+    LoaderProvider(sbin::Loader* module_loader, std::string decrypt_key) :
+        m_loader(module_loader), m_decrypt_key(std::move(decrypt_key)) {}
+
+    bool read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file) override;
+
+    bool read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content) override;
+};
+
+// The first provider that has the include, e.g. memory, then loader, then disk
+class PPS_API ChainProvider : public IncludeProvider
+{
+    std::vector<IncludeProvider*> m_providers;
+
+public:
+    ChainProvider() = default;
+
+    ChainProvider(std::initializer_list<IncludeProvider*> providers) :
+        m_providers(providers) {}
+
+    void add(IncludeProvider* provider);
+
+    bool read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file) override;
+
+    void prefetch(const std::vector<std::string>& paths, const std::set<std::string>& prefixes) override;
+
+    bool read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content) override;
+};
+
+} // namespace pps
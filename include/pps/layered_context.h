@@ -0,0 +1,65 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <memory>
+#include <optional>
+
+namespace pps
+{
+
+// A shared base context with a small layer of changes on top. Layers only hold their
+// changes, so thousands of permutations of a large base cost memory proportional to
+// what they change. Lookups go through the layer, then the base; the fingerprint is
+// derived from the base's and the changes. Copies share the base and its hashes, so
+// permutations are best made from copies of one layered context.
+class PPS_API LayeredContext
+{
+public:
+    // Hashes the entries of `base` once
+    explicit LayeredContext(std::shared_ptr<const Context> base);
+
+    void set_bool(const std::string& name, bool value);
+    void set_int(const std::string& name, int value);
+    void set_string(const std::string& name, const std::string& value);
+    void set_instance(const std::string& name, const std::string& value);
+    void add_prefix(const std::string& prefix);
+    void set_static(bool is_static);
+
+    // nullptr when neither the layer nor the base defines `name`
+    const bool*        find_bool(const std::string& name) const;
+    const int*         find_int(const std::string& name) const;
+    const std::string* find_string(const std::string& name) const;
+    const std::string* find_instance(const std::string& name) const;
+
+    bool is_static() const;
+
+    const std::shared_ptr<const Context>& base() const { return m_base->context; }
+
+    // The changes alone, without isStatic
+    const Context& layer() const { return m_layer; }
+
+    // Equal to flatten().fingerprint(), in time proportional to the layer
+    Fingerprint fingerprint() const;
+
+    // A plain context with the layer merged into a copy of the base
+    Context flatten() const;
+
+    // Write the layer over `target`, which must equal the base, and restore it afterwards.
+    // Sessions keep a copy of the base to process layers without copying it per call.
+    void apply(Context& target) const;
+    void revert(Context& target) const;
+
+private:
+    struct Base
+    {
+        std::shared_ptr<const Context> context;
+        Fingerprint                    sum; // Entry hashes of the base, before isStatic is mixed in
+    };
+
+    std::shared_ptr<const Base> m_base;
+    Context                     m_layer;
+    std::optional<bool>         m_static;
+};
+
+} // namespace pps
@@ -2,7 +2,12 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <future>
+#include <memory_resource>
 #include <set>
+#include <vector>
 
 #if _WIN32
 #    ifdef PPS_EXPORT_DLL
@@ -22,7 +27,16 @@ class Loader;
 namespace pps
 {
 
-struct Context
+// 128-bit hash of a Context
+struct Fingerprint
+{
+    uint64_t low  = 0;
+    uint64_t high = 0;
+
+    bool operator==(const Fingerprint&) const = default;
+};
+
+struct PPS_API Context
 {
     // Defined variables
     std::unordered_map<std::string, bool>        bools;
@@ -37,24 +51,100 @@ struct Context
 
     // Is static mode
     bool isStatic = true;
+
+    // Stable across runs and machines, independent of the iteration order of the maps.
+    // Without `prefixes`, equal to the fingerprint of a copy with no include prefixes.
+    Fingerprint fingerprint(bool prefixes = true) const;
+
+    // Compact canonical binary form: equal contexts serialize to equal bytes
+    std::string serialize() const;
+
+    // Replace this context with a serialized one; false if `data` is malformed
+    bool deserialize(std::string_view data);
+
+    bool operator==(const Context& other) const = default;
 };
 
-class Task;
+class Engine;
+class Session;
+class Cache;
+class FileCache;
+struct Stats;
+class Tracer;
+class Executor;
+class DiagnosticSink;
+class CancellationToken;
+class LayeredContext;
+
+// One engine with one session, for single-threaded use; threads that share caches
+// share an Engine and own a Session each (see pps/engine.h)
 class PPS_API PPS
 {
-    Task* m_task;
+    Engine*  m_engine;
+    Session* m_session;
 
 public:
     PPS();
 
     ~PPS();
 
+    PPS(const PPS&)            = delete;
+    PPS& operator=(const PPS&) = delete;
+
     std::string process(const std::string& source, Context* context);
 
     std::string process(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
 
-private:
-    std::string process(const std::string& source);
+    // Replace the content of `output` with the result, reusing its capacity; see Session::process_into
+    void process_into(std::string& output, const std::string& source, Context* context);
+
+    void process_into(std::string& output, const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Process with a base context and a layer of changes, without copying the base per call
+    std::string process(const std::string& source, const LayeredContext& context);
+
+    // Process on the executor while the includes are read ahead concurrently; see Session::process_async
+    std::future<std::string> process_async(const std::string& source, Context* context);
+
+    std::future<std::string> process_async(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Generate one output per context, sharing the work of common decision prefixes
+    std::vector<std::string> process(const std::string& source, const std::vector<Context*>& contexts);
+
+    std::vector<std::string> process(const std::string& source, const std::vector<Context*>& contexts, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Look up and store outputs in `cache`; nullptr disables caching
+    void set_cache(Cache* cache);
+
+    // Read includes through a cache shared with other instances; nullptr reads from disk
+    void set_file_cache(FileCache* files);
+
+    // Run asynchronous calls on `executor`; nullptr uses default_executor()
+    void set_executor(Executor* executor);
+
+    // Accumulate stage timings and counters of the following calls into `stats`;
+    // nullptr falls back to the global stats, if any
+    void set_stats(Stats* stats);
+
+    // Report the slices of the following calls to `tracer`; nullptr falls back to the global tracer, if any
+    void set_tracer(Tracer* tracer);
+
+    // Report the diagnostics of the following calls to `diagnostics`; nullptr logs them through aclg
+    void set_diagnostics(DiagnosticSink* diagnostics);
+
+    // Abort the following calls with pps::Cancelled once `token` is cancelled or past its deadline
+    void set_cancellation(const CancellationToken* token);
+
+    // Allocate the scratch objects of the following calls from `resource`; see Session::set_memory_resource
+    void set_memory_resource(std::pmr::memory_resource* resource);
+
+    // Resolved paths of the files included by the last call; loader-sourced ones as "@loader/<path>"
+    const std::vector<std::string>& dependencies() const;
+
+    // Resolve what the (partial) context binds and emit residual pps source for the rest
+    std::string specialize(const std::string& source, Context* context);
+
+    std::string specialize(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
 };
 
 } // namespace pps
@@ -0,0 +1,93 @@
+#pragma once
+
+/* C interface of libpps, for hosts that must not share STL types with the library.
+ * Handles are opaque and owned by the caller through the create/destroy pairs. Strings
+ * passed in are copied or only read during the call, and outputs are written to buffers
+ * the caller owns, so no allocation crosses the library boundary. No function throws.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if _WIN32
+#    ifdef PPS_EXPORT_DLL
+#        define PPS_C_API __declspec(dllexport)
+#    else
+#        define PPS_C_API __declspec(dllimport)
+#    endif
+#else
+#    define PPS_C_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum pps_status
+{
+    PPS_OK = 0,
+    PPS_INVALID_ARGUMENT,
+    PPS_BUFFER_TOO_SMALL, /* The output is kept; read it with pps_session_read_output */
+    PPS_FAILED,           /* See pps_session_last_error */
+} pps_status;
+
+/* Caches and settings shared by the sessions created from it */
+typedef struct pps_engine pps_engine;
+
+/* Processes on one thread at a time; threads own a session each */
+typedef struct pps_session pps_session;
+
+/* Source prepared once, processed any number of times from any session */
+typedef struct pps_template pps_template;
+
+/* Variables of a call, built from flat arrays */
+typedef struct pps_context pps_context;
+
+PPS_C_API pps_engine* pps_engine_create(void);
+PPS_C_API void        pps_engine_destroy(pps_engine* engine);
+
+/* Process sources of at least `bytes` in parallel regions; 0 disables it */
+PPS_C_API void pps_engine_set_parallel_threshold(pps_engine* engine, size_t bytes);
+
+/* Expand each file once per call; see Engine::set_include_once */
+PPS_C_API void pps_engine_set_include_once(pps_engine* engine, int once);
+
+/* The engine must outlive the session */
+PPS_C_API pps_session* pps_session_create(const pps_engine* engine);
+PPS_C_API void         pps_session_destroy(pps_session* session);
+
+PPS_C_API pps_template* pps_template_create(const char* source, size_t size);
+PPS_C_API void          pps_template_destroy(pps_template* prepared);
+
+PPS_C_API pps_context* pps_context_create(void);
+PPS_C_API void         pps_context_destroy(pps_context* context);
+
+/* Remove every variable and prefix, and go back to static mode */
+PPS_C_API void pps_context_clear(pps_context* context);
+
+PPS_C_API void pps_context_set_static(pps_context* context, int is_static);
+
+/* Define `count` variables; names and values are parallel arrays of NUL-terminated
+ * strings. Names already defined take the new value. */
+PPS_C_API pps_status pps_context_set_bools(pps_context* context, const char* const* names, const int* values, size_t count);
+PPS_C_API pps_status pps_context_set_ints(pps_context* context, const char* const* names, const int* values, size_t count);
+PPS_C_API pps_status pps_context_set_strings(pps_context* context, const char* const* names, const char* const* values, size_t count);
+PPS_C_API pps_status pps_context_set_instances(pps_context* context, const char* const* names, const char* const* values, size_t count);
+PPS_C_API pps_status pps_context_add_prefixes(pps_context* context, const char* const* prefixes, size_t count);
+
+/* Process into `buffer`, which is not NUL-terminated. `size` receives the size of the
+ * output. When it exceeds `capacity`, nothing is written and PPS_BUFFER_TOO_SMALL is
+ * returned; `buffer` may be NULL with a `capacity` of 0 to query the size. */
+PPS_C_API pps_status pps_session_process(pps_session* session, const pps_template* prepared, pps_context* context, char* buffer, size_t capacity, size_t* size);
+
+PPS_C_API pps_status pps_session_process_source(pps_session* session, const char* source, size_t source_size, pps_context* context, char* buffer, size_t capacity, size_t* size);
+
+/* Copy the output of the last call, without processing again */
+PPS_C_API pps_status pps_session_read_output(const pps_session* session, char* buffer, size_t capacity, size_t* size);
+
+/* NUL-terminated message of the last PPS_FAILED call, valid until the next call */
+PPS_C_API const char* pps_session_last_error(const pps_session* session);
+
+#ifdef __cplusplus
+}
+#endif
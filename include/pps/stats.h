@@ -0,0 +1,88 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <cstdint>
+#include <string>
+
+namespace pps
+{
+
+// Timed stages; times are inclusive, e.g. include resolution contains include I/O,
+// while allocations count towards the innermost stage only
+enum class Stage : uint8_t
+{
+    tScan,     // Directive scanning
+    tLex,      // Expression lexing
+    tParse,    // Expression parsing
+    tEvaluate, // Condition evaluation
+    tSimplify, // Dynamic simplification and partial specialization
+    tGenerate, // Condition code generation
+    tInclude,  // Include resolution
+    tIncludeIO,
+    tLoader, // Loader fetches
+    tFormat, // format_pps_indent and limit_conherent_enters
+    tOutput, // Appending lines to the output
+    tCount,
+};
+
+enum class Directive : uint8_t
+{
+    tStatic,
+    tDynamic,
+    tInclude,
+    tOverride,
+    tEmbed,
+    tProg,
+    tPragma,
+    tCount,
+};
+
+struct StageStats
+{
+    uint64_t nanoseconds     = 0;
+    uint64_t count           = 0;
+    uint64_t allocations     = 0;
+    uint64_t allocated_bytes = 0;
+};
+
+// Cumulative counters of one PPS instance, or of every instance with set_global_stats().
+// Nothing is measured while no Stats is attached.
+struct PPS_API Stats
+{
+    StageStats stages[size_t(Stage::tCount)];
+    uint64_t   directives[size_t(Directive::tCount)] = {};
+
+    uint64_t bytes_in     = 0;
+    uint64_t bytes_out    = 0;
+    uint64_t lines        = 0;
+    uint64_t cache_hits   = 0;
+    uint64_t cache_misses = 0;
+
+    // Allocations of whole calls, in or out of a stage; zero unless allocations are tracked
+    // (see record_allocation())
+    uint64_t allocations     = 0;
+    uint64_t allocated_bytes = 0;
+
+    const StageStats& operator[](Stage stage) const { return stages[size_t(stage)]; }
+    uint64_t          operator[](Directive directive) const { return directives[size_t(directive)]; }
+
+    Stats& operator+=(const Stats& other);
+
+    void reset();
+
+    std::string to_json() const;
+
+    static const char* name(Stage stage);
+    static const char* name(Directive directive);
+};
+
+// Stats that every PPS without its own receives; the calls merge into it under a lock
+PPS_API void set_global_stats(Stats* stats);
+
+// Attribute an allocation to the PPS call and stage running on this thread, if it
+// has stats. libpps built with enable_pps_alloc_tracking calls it from operator new;
+// custom allocators can call it too.
+PPS_API void record_allocation(size_t size);
+
+} // namespace pps
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pps
+{
+
+// Receives properly nested begin/end pairs from the thread that runs a PPS call:
+// category "process" for each call, "directive" for each directive line (named by
+// its kind) and "include" for each include expansion (named by its path).
+class PPS_API Tracer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~Tracer() = default;
+
+    virtual void begin(const char* category, const std::string& name) = 0;
+    virtual void end(const char* category)                            = 0;
+
+    // Events of a parallel region, passed on by the calling thread once the region is
+    // accepted, with the time and thread of the work. Nested per thread like the others;
+    // by default they are taken as if they happened now.
+    virtual void begin_at(const char* category, const std::string& name, Clock::time_point /*time*/, std::thread::id /*thread*/) { begin(category, name); }
+    virtual void end_at(const char* category, Clock::time_point /*time*/, std::thread::id /*thread*/) { end(category); }
+};
+
+// Records events in the Chrome/Perfetto trace-event format; safe to share between threads
+class PPS_API ChromeTracer : public Tracer
+{
+    struct Event
+    {
+        const char* category;
+        std::string name;
+        double      timestamp; // Microseconds since the tracer was created
+        uint32_t    thread;
+        bool        begin;
+    };
+
+    std::mutex                   m_mutex;
+    std::vector<Event>           m_events;
+    std::vector<std::thread::id> m_threads;
+    uint64_t                     m_start;
+
+public:
+    ChromeTracer();
+
+    void begin(const char* category, const std::string& name) override;
+    void end(const char* category) override;
+    void begin_at(const char* category, const std::string& name, Clock::time_point time, std::thread::id thread) override;
+    void end_at(const char* category, Clock::time_point time, std::thread::id thread) override;
+
+    std::string to_json();
+
+    bool write(const std::string& path);
+
+private:
+    void _record(const char* category, const std::string& name, bool begin, Clock::time_point time, std::thread::id thread);
+};
+
+// Tracer that every PPS without its own receives
+PPS_API void set_global_tracer(Tracer* tracer);
+
+} // namespace pps
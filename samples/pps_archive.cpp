@@ -0,0 +1,142 @@
+#include <pps/archive.h>
+#include <filesystem>
+#include <iostream>
+
+int main()
+{
+    std::string line = R"(
+void main(out float4 color)
+{
+    /*<$static if @useShadow>*/
+    color.rgb *= shadow(uv);
+    /*<$static endif>*/
+    /*<$static if @quality == 2>*/
+    color.rgb *= ao(uv);
+    /*<$static endif>*/
+}
+)";
+
+    auto path = (std::filesystem::temp_directory_path() / "pps_archive_sample.ppsa").string();
+
+    // Eight permutations, @quality 0 and 1 produce the same output
+    std::vector<pps::Context> contexts;
+    std::vector<std::string>  outputs;
+    {
+        pps::ArchiveWriter writer;
+        writer.open(path);
+
+        pps::PPS lang;
+        for (int i = 0; i < 8; i++)
+        {
+            pps::Context ctx;
+            ctx.bools    = {{"@useShadow", (i & 1) != 0}};
+            ctx.ints     = {{"@quality", i >> 1}};
+            ctx.prefixes = {"shaders/"};
+
+            outputs.push_back(lang.process(line, &ctx));
+            contexts.push_back(ctx);
+            writer.add(ctx, outputs.back());
+        }
+
+        std::cout << "pps archive: " << writer.size() << " entries, " << writer.duplicates() << " duplicates" << std::endl;
+        writer.finish();
+    }
+
+    int passed = 0;
+    int total  = 0;
+
+    pps::ArchiveReader reader;
+    total++;
+    if (reader.open(path) && reader.size() == contexts.size())
+    {
+        passed++;
+        std::cout << "[PASS] open: " << reader.size() << " entries" << std::endl;
+    }
+    else
+    {
+        std::cout << "[FAIL] open" << std::endl;
+    }
+
+    for (size_t i = 0; i < contexts.size(); i++)
+    {
+        // The runtime looks permutations up without include paths
+        pps::Context runtime = contexts[i];
+        runtime.prefixes.clear();
+
+        std::string_view output;
+        total++;
+        if (reader.find(runtime, output) && output == outputs[i])
+        {
+            passed++;
+            std::cout << "[PASS] find " << i << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] find " << i << ":\n"
+                      << output << "\nexpected:\n"
+                      << outputs[i] << std::endl;
+        }
+    }
+
+    pps::Context missing;
+    missing.bools = {{"@useShadow", true}};
+    missing.ints  = {{"@quality", 7}};
+
+    std::string_view output;
+    total++;
+    if (!reader.find(missing, output))
+    {
+        passed++;
+        std::cout << "[PASS] missing context" << std::endl;
+    }
+    else
+    {
+        std::cout << "[FAIL] missing context found" << std::endl;
+    }
+
+    // Deduplicated outputs share one blob
+    std::string_view first;
+    std::string_view second;
+    total++;
+    if (reader.find(contexts[0], first) && reader.find(contexts[2], second) && first.data() == second.data())
+    {
+        passed++;
+        std::cout << "[PASS] duplicate stored once" << std::endl;
+    }
+    else
+    {
+        std::cout << "[FAIL] duplicate stored twice" << std::endl;
+    }
+
+    reader.close();
+
+    // A context added several times keeps the output it was first added with
+    {
+        pps::ArchiveWriter writer;
+        writer.open(path);
+        for (int i = 0; i < 100; i++)
+        {
+            writer.add(contexts[i % 2], "repeat " + std::to_string(i));
+            writer.add(contexts[2 + i % 6], "other " + std::to_string(i));
+        }
+        writer.finish();
+    }
+
+    std::string_view kept;
+    total++;
+    if (reader.open(path) && reader.size() == contexts.size() && reader.find(contexts[1], kept) && kept == "repeat 1")
+    {
+        passed++;
+        std::cout << "[PASS] first output kept" << std::endl;
+    }
+    else
+    {
+        std::cout << "[FAIL] first output kept: " << kept << std::endl;
+    }
+
+    reader.close();
+    std::filesystem::remove(path);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
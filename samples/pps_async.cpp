@@ -0,0 +1,96 @@
+#include <pps/engine.h>
+#include <pps/executor.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Counts the jobs it forwards to a pool
+class CountingExecutor : public pps::Executor
+{
+public:
+    pps::ThreadPool  pool{2};
+    std::atomic<int> jobs = 0;
+
+    void post(std::function<void()> job) override
+    {
+        jobs++;
+        pool.post(std::move(job));
+    }
+};
+
+int main()
+{
+    auto dir = std::filesystem::temp_directory_path() / "pps_async_sample";
+    std::filesystem::create_directories(dir);
+
+    auto write = [&](const std::string& name, const std::string& content) {
+        std::ofstream(dir / name, std::ios::binary) << content;
+    };
+    write("common.hlsl", "float common;\n/*<$include light.hlsl>*/\n");
+    write("light.hlsl", "/*<$static if @useShadow>*/\nfloat shadow;\n/*<$static endif>*/\n");
+    write("fog.hlsl", "float fog;\n");
+    write("unused.hlsl", "float unused;\n");
+
+    std::string line = R"(
+/*<$include common.hlsl>*/
+/*<$static if @useFog>*/
+/*<$include fog.hlsl>*/
+/*<$static else>*/
+/*<$include unused.hlsl>*/
+/*<$static endif>*/
+void main(out float4 color)
+{
+    /*<$include light.hlsl>*/
+}
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    CountingExecutor executor;
+    pps::Engine      engine;
+    engine.set_executor(&executor);
+
+    for (int i = 0; i < 4; i++)
+    {
+        pps::Context ctx;
+        ctx.bools    = {{"@useShadow", (i & 1) != 0}, {"@useFog", (i & 2) != 0}};
+        ctx.prefixes = {dir.generic_string() + "/"};
+
+        pps::Session sync(engine);
+        auto         expected = sync.process(line, &ctx);
+
+        pps::Session session(engine);
+        auto         result = session.process_async(line, &ctx).get();
+        check("permutation " + std::to_string(i), result == expected && session.dependencies() == sync.dependencies());
+    }
+
+    // The call and every distinct include were posted
+    check("executor", executor.jobs == 4 * 5);
+
+    pps::PPS     lang;
+    pps::Context ctx;
+    ctx.bools    = {{"@useShadow", true}, {"@useFog", true}};
+    ctx.prefixes = {dir.generic_string() + "/"};
+    auto result  = lang.process_async(line, &ctx).get();
+    check("default executor", result.find("float fog;") != std::string::npos && result.find("float unused;") == std::string::npos);
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
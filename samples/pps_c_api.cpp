@@ -0,0 +1,81 @@
+#include <pps/pps_c.h>
+#include <pps/engine.h>
+#include <iostream>
+#include <string>
+
+int main()
+{
+    std::string source = R"(
+/*<$static if @useShadow>*/
+float shadow;
+/*<$static endif>*/
+/*<$static if @quality == 2>*/
+float high;
+/*<$static else>*/
+float low;
+/*<$static endif>*/
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Context ctx;
+    ctx.bools = {{"@useShadow", true}};
+    ctx.ints  = {{"@quality", 2}};
+
+    pps::Engine  reference_engine;
+    pps::Session reference(reference_engine);
+    auto         expected = reference.process(source, &ctx);
+
+    auto engine   = pps_engine_create();
+    auto session  = pps_session_create(engine);
+    auto prepared = pps_template_create(source.data(), source.size());
+    auto context  = pps_context_create();
+
+    const char* bool_names[]  = {"@useShadow"};
+    const int   bool_values[] = {1};
+    const char* int_names[]   = {"@quality"};
+    const int   int_values[]  = {2};
+    check("flat arrays", pps_context_set_bools(context, bool_names, bool_values, 1) == PPS_OK && pps_context_set_ints(context, int_names, int_values, 1) == PPS_OK);
+
+    const char* missing[] = {nullptr};
+    check("invalid names", pps_context_set_bools(context, missing, bool_values, 1) == PPS_INVALID_ARGUMENT);
+
+    size_t size = 0;
+    check("size query", pps_session_process(session, prepared, context, nullptr, 0, &size) == PPS_BUFFER_TOO_SMALL && size == expected.size());
+
+    std::string buffer(size, '\0');
+    check("kept output", pps_session_read_output(session, buffer.data(), buffer.size(), &size) == PPS_OK && buffer == expected);
+
+    std::string large(4096, '\0');
+    check("template", pps_session_process(session, prepared, context, large.data(), large.size(), &size) == PPS_OK && large.substr(0, size) == expected);
+    check("source", pps_session_process_source(session, source.data(), source.size(), context, large.data(), large.size(), &size) == PPS_OK && large.substr(0, size) == expected);
+
+    const int off[] = {0};
+    pps_context_clear(context);
+    pps_context_set_bools(context, bool_names, off, 1);
+    pps_context_set_ints(context, int_names, off, 1);
+    check("cleared", pps_session_process(session, prepared, context, large.data(), large.size(), &size) == PPS_OK && large.substr(0, size).find("float low;") != std::string::npos);
+    check("no error", std::string(pps_session_last_error(session)).empty());
+
+    pps_context_destroy(context);
+    pps_template_destroy(prepared);
+    pps_session_destroy(session);
+    pps_engine_destroy(engine);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include <pps/engine.h>
+#include <pps/cache.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+int main()
+{
+    auto dir = std::filesystem::temp_directory_path() / "pps_cache_sample";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "high");
+    std::filesystem::create_directories(dir / "low");
+    std::ofstream(dir / "low" / "common.hlsl", std::ios::binary) << "float base;\n";
+
+    std::string source = R"(
+/*<$include common.hlsl>*/
+/*<$static if @useExtra>*/
+/*<$include extra.hlsl>*/
+/*<$static endif>*/
+float main;
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Cache  cache((dir / "cache").generic_string());
+    pps::Engine engine;
+    engine.set_cache(&cache);
+
+    pps::Context ctx;
+    ctx.bools    = {{"@useExtra", true}};
+    ctx.prefixes = {(dir / "high").generic_string() + "/", (dir / "low").generic_string() + "/"};
+
+    // Processed fresh each time, for the expected output
+    auto direct = [&]() {
+        pps::Engine  plain;
+        pps::Session session(plain);
+        auto         copy = ctx;
+        return session.process(source, &copy);
+    };
+
+    pps::Session session(engine);
+    auto         first  = session.process(source, &ctx);
+    auto         second = session.process(source, &ctx);
+    check("hit", first == second && first.find("float base;") != std::string::npos && cache.stats().hits == 1);
+
+    // A file in a prefix probed before the hit now shadows it; prefixes are tried in sorted order
+    std::ofstream(dir / "high" / "common.hlsl", std::ios::binary) << "float shadowing;\n";
+    auto shadowed = session.process(source, &ctx);
+    check("shadowing candidate", shadowed == direct() && shadowed.find("float shadowing;") != std::string::npos && cache.stats().hits == 1);
+
+    // An include that was not found anywhere now resolves
+    std::ofstream(dir / "low" / "extra.hlsl", std::ios::binary) << "float extra;\n";
+    auto resolved = session.process(source, &ctx);
+    check("resolved include", resolved == direct() && resolved.find("float extra;") != std::string::npos && cache.stats().hits == 1);
+
+    // An edited dependency with a new size and time is hashed again
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(dir / "low" / "extra.hlsl", std::ios::binary) << "float extra2;\n";
+    auto edited = session.process(source, &ctx);
+    check("edited dependency", edited == direct() && edited.find("float extra2;") != std::string::npos);
+    check("unchanged hit", session.process(source, &ctx) == edited && cache.stats().hits == 2);
+
+    // Storing over an existing entry does not grow the tracked size
+    auto bytes = cache.stats().bytes;
+    cache.store(source, ctx, {"@useExtra"}, {}, {}, nullptr, "", edited);
+    auto again = cache.stats().bytes;
+    cache.store(source, ctx, {"@useExtra"}, {}, {}, nullptr, "", edited);
+    check("overwrite size", again > bytes && cache.stats().bytes == again);
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
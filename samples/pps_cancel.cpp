@@ -0,0 +1,99 @@
+#include <pps/cancel.h>
+#include <pps/engine.h>
+#include <pps/executor.h>
+#include <iostream>
+#include <thread>
+
+int main()
+{
+    std::string line = R"(
+/*<$static if @useShadow>*/
+float shadow;
+/*<$static endif>*/
+)";
+
+    // Builds a string of 200 MB before failing, unless the call is stopped
+    std::string runaway = R"(
+/*<$static if "ab" * 100000000 << 1>*/
+float never;
+/*<$static endif>*/
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    auto status = [](const std::function<void()>& call) {
+        try
+        {
+            call();
+        }
+        catch (const pps::Cancelled& cancelled)
+        {
+            return cancelled.status();
+        }
+        catch (const std::exception&)
+        {
+        }
+        return pps::CancelStatus::tRunning;
+    };
+
+    pps::Context ctx;
+    ctx.bools = {{"@useShadow", true}};
+
+    pps::Engine  engine;
+    pps::Session session(engine);
+
+    pps::CancellationToken idle;
+    session.set_cancellation(&idle);
+    check("not cancelled", session.process(line, &ctx).find("float shadow;") != std::string::npos);
+
+    pps::CancellationToken cancelled;
+    cancelled.cancel();
+    session.set_cancellation(&cancelled);
+    check("cancelled", status([&]() { session.process(line, &ctx); }) == pps::CancelStatus::tCancelled);
+    check("batch", status([&]() { session.process(line, std::vector<pps::Context*>{&ctx, &ctx}); }) == pps::CancelStatus::tCancelled);
+
+    pps::CancellationToken expired(std::chrono::milliseconds(0));
+    session.set_cancellation(&expired);
+    check("timed out", status([&]() { session.process(line, &ctx); }) == pps::CancelStatus::tTimedOut);
+
+    auto                   start = std::chrono::steady_clock::now();
+    pps::CancellationToken deadline(std::chrono::milliseconds(20));
+    session.set_cancellation(&deadline);
+    auto result  = status([&]() { session.process(runaway, &ctx); });
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    check("evaluation deadline", result == pps::CancelStatus::tTimedOut && elapsed < std::chrono::seconds(5));
+
+    // Lines processed before the deadline do not stay in the output
+    std::string            output = "stale";
+    pps::CancellationToken partial(std::chrono::milliseconds(20));
+    session.set_cancellation(&partial);
+    result = status([&]() { session.process_into(output, "float before;\n" + runaway, &ctx); });
+    check("no partial output", result == pps::CancelStatus::tTimedOut && output.empty());
+
+    pps::CancellationToken stop;
+    session.set_cancellation(&stop);
+    auto future = session.process_async(runaway, &ctx);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stop.cancel();
+    check("async cancel", status([&]() { future.get(); }) == pps::CancelStatus::tCancelled);
+
+    session.set_cancellation(nullptr);
+    check("reusable", session.process(line, &ctx).find("float shadow;") != std::string::npos);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include <pps/diagnostics.h>
+#include <pps/engine.h>
+#include <pps/include_provider.h>
+#include <iostream>
+
+int main()
+{
+    pps::MemoryProvider memory;
+    memory.add("light.hlsl", "float light;\n/*<$static if @missing == 1>*/\nfloat missing;\n/*<$static endif>*/\n");
+
+    std::string line = R"(/*<$include light.hlsl>*/
+/*<$include light.hlsl>*/
+/*<$static if @undefined == 1>*/
+float undefined;
+/*<$static endif>*/
+/*<$include absent.hlsl>*/
+/*<$include light.hlsl>*/
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    auto find = [](const std::vector<pps::Diagnostic>& entries, pps::DiagnosticCode code, const std::string& file) {
+        for (const auto& entry : entries)
+        {
+            if (entry.code == code && entry.file == file)
+                return entry;
+        }
+        return pps::Diagnostic();
+    };
+
+    pps::Context ctx;
+
+    pps::Diagnostics diagnostics;
+    pps::Engine      engine;
+    engine.set_include_provider(&memory);
+    engine.set_include_memo(false);
+    engine.set_diagnostics(&diagnostics);
+
+    pps::Session session(engine);
+    session.process(line, &ctx);
+    auto entries = diagnostics.entries();
+
+    auto undefined = find(entries, pps::DiagnosticCode::tUndefinedVariable, "");
+    check("location", undefined.line == 3 && undefined.severity == pps::Severity::tError && undefined.message.find("@undefined") != std::string::npos);
+
+    auto missing = find(entries, pps::DiagnosticCode::tUndefinedVariable, "@memory/light.hlsl");
+    check("include location", missing.line == 2 && missing.count == 3);
+
+    auto absent = find(entries, pps::DiagnosticCode::tIncludeNotFound, "");
+    check("include not found", absent.line == 6 && absent.message.find("absent.hlsl") != std::string::npos);
+    check("count", entries.size() == 3 && diagnostics.count(pps::DiagnosticCode::tUndefinedVariable) == 4);
+
+    pps::Diagnostics limited(1);
+    session.set_diagnostics(&limited);
+    session.process(line, &ctx);
+    check("limit", limited.count(pps::DiagnosticCode::tUndefinedVariable) == 4 && limited.suppressed() == 1 && limited.entries().size() == 2);
+
+    pps::Diagnostics quiet;
+    quiet.set_messages(false);
+    session.set_diagnostics(&quiet);
+    session.process(line, &ctx);
+    entries = quiet.entries();
+    check("no messages", entries.size() == 3 && entries[0].message.empty() && entries[0].line != 0);
+
+    // Every context of a batch reaches the same lines; they count at one location each
+    diagnostics.clear();
+    session.set_diagnostics(nullptr);
+    pps::Context other;
+    other.bools = {{"@unused", true}};
+    session.process(line, std::vector<pps::Context*>{&ctx, &other});
+    entries = diagnostics.entries();
+    check("batch", entries.size() == 3 && find(entries, pps::DiagnosticCode::tUndefinedVariable, "").count == 2);
+
+    diagnostics.clear();
+    engine.set_parallel_threshold(1);
+    session.process(line, &ctx);
+    check("regions", find(diagnostics.entries(), pps::DiagnosticCode::tIncludeNotFound, "").line == 6);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
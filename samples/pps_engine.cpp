@@ -0,0 +1,107 @@
+#include <pps/engine.h>
+#include <pps/stats.h>
+#include <iostream>
+#include <thread>
+
+int main()
+{
+    std::string line = R"(
+SamplerState s_LinearWrap : register(s0 /*<$override @sLinearWrap>*/);
+void main(out float4 color)
+{
+    /*<$static if @hasBaseColorMap>*/
+    color.rgb *= texture(baseColorMap, uv).rgb;
+    /*<$static endif>*/
+    /*<$static if @useShadow>*/
+    color.rgb *= 0.9f;
+    /*<$static elif @quality == 2>*/
+    color.rgb *= ao(uv);
+    /*<$static endif>*/
+})";
+
+    std::vector<pps::Context> contexts;
+    for (int i = 0; i < 16; i++)
+    {
+        pps::Context ctx;
+        ctx.bools = {
+            {"@hasBaseColorMap", (i & 1) != 0},
+            {"@useShadow", (i & 2) != 0},
+        };
+        ctx.ints    = {{"@quality", i >> 2}};
+        ctx.strings = {{"@sLinearWrap", "s" + std::to_string(i)}};
+        contexts.push_back(ctx);
+    }
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    std::vector<std::string> expected;
+    for (auto& ctx : contexts)
+    {
+        pps::PPS lang;
+        expected.push_back(lang.process(line, &ctx));
+    }
+
+    pps::Stats  shared;
+    pps::Engine engine;
+    engine.set_stats(&shared);
+    auto prepared = engine.prepare(line);
+
+    // Sessions on several threads share the engine and the prepared template
+    std::vector<std::string> outputs(contexts.size());
+    std::vector<std::string> plain(contexts.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&, t]() {
+            pps::Session session(engine);
+            for (size_t i = t; i < contexts.size(); i += 4)
+            {
+                auto ctx   = contexts[i];
+                outputs[i] = session.process(*prepared, &ctx);
+                plain[i]   = session.process(line, &ctx);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    check("threads", outputs == expected);
+    check("template", plain == expected);
+    check("shared stats", shared[pps::Directive::tStatic] == 2 * contexts.size() * 5 &&
+                              shared[pps::Stage::tScan].count == contexts.size() * (prepared->lines().size() + 6));
+
+    // State left by an unbalanced source does not leak into the next call
+    pps::Session session(engine);
+    auto         ctx = contexts[0];
+    session.process("/*<$static if @useShadow>*/\nlost\n", &ctx);
+    check("reset", session.process(line, &ctx) == expected[0]);
+
+    // Directives inside a skipped branch leave nothing of their payload behind
+    auto skipped = session.process(R"(/*<$static if @useShadow>*/
+/*<$include missing.hlsl>*/
+SamplerState s_Skipped : register(s1 /*<$override @sLinearWrap>*/);
+/*<$embed @payload>*/
+/*<$prog payload>*/
+/*<$static endif>*/
+kept)",
+                                   &ctx);
+    check("skipped payloads", skipped.find("kept") != std::string::npos && skipped.find("missing") == std::string::npos &&
+                                  skipped.find("@sLinearWrap") == std::string::npos && skipped.find("payload") == std::string::npos);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -4,12 +4,16 @@
 #include <vector>
 #include <iostream>
 #include <cassert>
+#include <optional>
 
 // Structure to hold test cases
 struct TestCase
 {
     std::string name;
     std::string input;
+
+    // Value the last expression must yield, when given
+    std::optional<std::variant<bool, int, std::string>> expected;
 };
 
 // Test cases covering various expression types and edge cases
@@ -50,6 +54,11 @@ const std::vector<TestCase> testCases = {
         string @s3 = @s1 + @s2
         @s3
     )"},
+    {"Logical not", R"(
+        bool @p = false
+        bool @q = !@p
+        @q
+    )", true},
 };
 
 int main()
@@ -66,7 +75,7 @@ int main()
         pps::Evaluator evaluator;
         auto           result = evaluator.evaluate(root.get());
 
-        if (result)
+        if (result && (!test.expected || result->value == *test.expected))
         {
             passed++;
             std::cout << "[PASS] " << test.name << ": ";
@@ -0,0 +1,113 @@
+#include <pps/engine.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static size_t count(const std::string& text, const std::string& word)
+{
+    size_t found = 0;
+    for (auto pos = text.find(word); pos != std::string::npos; pos = text.find(word, pos + 1))
+        found++;
+    return found;
+}
+
+int main()
+{
+    auto dir = std::filesystem::temp_directory_path() / "pps_include_once_sample";
+    std::filesystem::create_directories(dir);
+
+    auto write = [&](const std::string& name, const std::string& content) {
+        std::ofstream(dir / name, std::ios::binary) << content;
+    };
+    write("once.hlsl", "/*<$pragma once>*/\nfloat once;\n");
+    write("light.hlsl", "/*<$static if @useShadow>*/\nfloat shadow;\n/*<$static else>*/\nfloat unlit;\n/*<$static endif>*/\n/*<$include once.hlsl>*/\n");
+    write("cycle_a.hlsl", "float cycleA;\n/*<$include cycle_b.hlsl>*/\n");
+    write("cycle_b.hlsl", "float cycleB;\n/*<$include cycle_a.hlsl>*/\n");
+    // Leaves a branch open for the including source to close
+    write("open.hlsl", "/*<$static if @quality == 2>*/\nfloat high;\n");
+
+    std::string line = R"(
+/*<$include light.hlsl>*/
+/*<$include once.hlsl>*/
+void main(out float4 color)
+{
+    /*<$static if @quality == 1>*/
+    /*<$include light.hlsl>*/
+    /*<$static endif>*/
+    /*<$include light.hlsl>*/
+    /*<$include open.hlsl>*/
+    /*<$include light.hlsl>*/
+    /*<$static endif>*/
+    /*<$include cycle_a.hlsl>*/
+}
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    std::vector<pps::Context> contexts;
+    for (int i = 0; i < 6; i++)
+    {
+        pps::Context ctx;
+        ctx.bools    = {{"@useShadow", (i & 1) != 0}};
+        ctx.ints     = {{"@quality", i >> 1}};
+        ctx.prefixes = {dir.generic_string() + "/"};
+        contexts.push_back(ctx);
+    }
+    std::vector<pps::Context*> ctxs;
+    for (auto& ctx : contexts)
+        ctxs.push_back(&ctx);
+
+    pps::Engine plain;
+    plain.set_include_memo(false);
+    pps::Engine memo;
+
+    std::vector<std::string> expected;
+    bool                     same = true;
+    for (auto& ctx : contexts)
+    {
+        pps::Session reference(plain);
+        expected.push_back(reference.process(line, &ctx));
+
+        pps::Session session(memo);
+        same = same && session.process(line, &ctx) == expected.back() && session.dependencies() == reference.dependencies();
+    }
+    check("memo", same);
+
+    pps::Session batch(memo);
+    check("memo batch", batch.process(line, ctxs) == expected);
+
+    pps::Engine parallel;
+    parallel.set_parallel_threshold(1);
+    pps::Session regions(parallel);
+    check("memo regions", regions.process(line, &contexts[5]) == expected[5]);
+
+    const auto& full = expected[5];
+    check("pragma once", count(full, "float once;") == 1);
+    check("repeated", count(full, "float shadow;") == 3);
+    check("cycle", count(full, "float cycleA;") == 1 && count(full, "float cycleB;") == 1);
+
+    pps::Engine once;
+    once.set_include_once(true);
+    pps::Session session(once);
+    auto         result = session.process(line, &contexts[5]);
+    check("include once", count(result, "float shadow;") == 1 && count(result, "float once;") == 1);
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <pps/engine.h>
+#include <pps/cache.h>
+#include <pps/file_cache.h>
+#include <pps/include_provider.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+// Forwards to another provider and records the prefetched batches
+class RecordingProvider : public pps::IncludeProvider
+{
+    pps::IncludeProvider& m_inner;
+
+public:
+    std::mutex                            mutex;
+    std::vector<std::vector<std::string>> batches;
+
+    explicit RecordingProvider(pps::IncludeProvider& inner) :
+        m_inner(inner) {}
+
+    bool read(const std::string& path, const std::set<std::string>& prefixes, pps::IncludeFile& file) override
+    {
+        return m_inner.read(path, prefixes, file);
+    }
+
+    void prefetch(const std::vector<std::string>& paths, const std::set<std::string>& /*prefixes*/) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batches.push_back(paths);
+    }
+};
+
+int main()
+{
+    auto dir = std::filesystem::temp_directory_path() / "pps_include_provider_sample";
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "light.hlsl", std::ios::binary) << "float disk;\n";
+
+    std::string line = R"(
+/*<$include common.hlsl>*/
+void main(out float4 color)
+{
+    /*<$static if @useLight>*/
+    /*<$include light.hlsl>*/
+    /*<$static endif>*/
+    /*<$include missing.hlsl>*/
+}
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Context ctx;
+    ctx.bools    = {{"@useLight", true}};
+    ctx.prefixes = {dir.generic_string() + "/"};
+
+    pps::MemoryProvider memory;
+    memory.add("common.hlsl", "float common;\n/*<$include shaders/shared.hlsl>*/");
+    memory.add(dir.generic_string() + "/shaders/shared.hlsl", "float shared;\n");
+    memory.add("light.hlsl", "float memory;\n");
+
+    pps::Engine  engine;
+    pps::Session session(engine);
+    engine.set_include_provider(&memory);
+    auto result = session.process(line, &ctx);
+    check("memory", result.find("float common;") != std::string::npos && result.find("float shared;") != std::string::npos &&
+                        result.find("float memory;") != std::string::npos && result.find("float disk;") == std::string::npos);
+
+    std::vector<std::string> dependencies = {"@memory/common.hlsl", "@memory/" + dir.generic_string() + "/shaders/shared.hlsl", "@memory/light.hlsl"};
+    check("memory dependencies", session.dependencies() == dependencies);
+
+    pps::FileCache      files;
+    pps::DiskProvider   disk(&files);
+    pps::ChainProvider  chain = {&memory, &disk};
+    engine.set_include_provider(&chain);
+    check("chain", session.process(line, &ctx) == result);
+
+    memory.remove("light.hlsl");
+    result = session.process(line, &ctx);
+    check("chain fallback", result.find("float disk;") != std::string::npos && session.dependencies().back() == dir.generic_string() + "/light.hlsl");
+
+    pps::Engine  legacy;
+    pps::Session reference(legacy);
+    engine.set_include_provider(&disk);
+    ctx.bools["@useLight"] = false;
+    check("disk", session.process("/*<$include light.hlsl>*/\n", &ctx) == reference.process("/*<$include light.hlsl>*/\n", &ctx));
+
+    ctx.bools["@useLight"] = true;
+    RecordingProvider recording(chain);
+    engine.set_include_provider(&recording);
+    auto prepared = engine.prepare(line);
+    result        = session.process(*prepared, &ctx);
+    check("template prefetch", !recording.batches.empty() && recording.batches.front() == std::vector<std::string>{"common.hlsl", "light.hlsl", "missing.hlsl"});
+
+    check("async", session.process_async(line, &ctx).get() == result);
+
+    // Cached outputs are validated against the provider's current buffers
+    pps::Cache cache((dir / "cache").generic_string());
+    engine.set_cache(&cache);
+    engine.set_include_provider(&memory);
+    session.process(line, &ctx);
+    session.process(line, &ctx);
+    memory.add("common.hlsl", "float changed;\n");
+    result = session.process(line, &ctx);
+    check("cache", cache.stats().hits == 1 && result.find("float changed;") != std::string::npos);
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include <pps/engine.h>
+#include <pps/layered_context.h>
+#include <iostream>
+#include <set>
+#include <vector>
+
+int main()
+{
+    std::string source = R"(
+/*<$static if @useShadow>*/
+float shadow;
+/*<$static endif>*/
+/*<$static if @quality == 2>*/
+float high;
+/*<$static else>*/
+float low;
+/*<$static endif>*/
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    auto base = std::make_shared<pps::Context>();
+    for (int i = 0; i < 300; i++)
+    {
+        base->bools["@flag" + std::to_string(i)]      = i % 2 == 0;
+        base->ints["@count" + std::to_string(i)]      = i;
+        base->strings["@name" + std::to_string(i)]    = "value" + std::to_string(i);
+        base->instances["@flag" + std::to_string(i)] = "mat.flag" + std::to_string(i);
+    }
+    base->bools["@useShadow"] = false;
+    base->ints["@quality"]    = 1;
+
+    pps::LayeredContext root(base);
+    check("empty layer", root.fingerprint() == base->fingerprint());
+
+    auto layer = root;
+    layer.set_bool("@useShadow", true);
+    layer.set_int("@quality", 2);
+    layer.set_string("@extra", "on");
+    layer.add_prefix("shaders/");
+    check("lookups", *layer.find_bool("@useShadow") && *layer.find_int("@quality") == 2 && *layer.find_int("@count7") == 7 &&
+                         *layer.find_string("@extra") == "on" && !layer.find_bool("@missing") && !base->bools["@useShadow"]);
+    check("incremental fingerprint", layer.fingerprint() == layer.flatten().fingerprint() && layer.fingerprint() != base->fingerprint());
+
+    // Setting a key to the base's value changes nothing
+    auto same = root;
+    same.set_int("@count7", 7);
+    same.set_static(base->isStatic);
+    check("unchanged value", same.fingerprint() == base->fingerprint());
+
+    pps::Engine   engine;
+    pps::Session  session(engine);
+    pps::Template prepared(source);
+
+    auto flat     = layer.flatten();
+    auto expected = session.process(source, &flat);
+    auto result   = session.process(prepared, layer);
+    check("process", result == expected && result.find("float shadow;") != std::string::npos && result.find("float high;") != std::string::npos);
+
+    // The session's copy of the base is restored between calls
+    auto plain = *base;
+    check("restored", session.process(source, root) == session.process(source, &plain));
+
+    // Permutations are copies of the root, each holding only its own change
+    std::vector<pps::LayeredContext>        permutations(50000, root);
+    std::set<std::pair<uint64_t, uint64_t>> fingerprints;
+    for (size_t i = 0; i < permutations.size(); i++)
+    {
+        permutations[i].set_int("@variant", int(i));
+        auto fingerprint = permutations[i].fingerprint();
+        fingerprints.insert({fingerprint.low, fingerprint.high});
+    }
+    check("shared base", fingerprints.size() == permutations.size() && permutations.back().base() == base);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <pps/engine.h>
+#include <iostream>
+#include <memory_resource>
+#include <thread>
+
+// Counts the allocations it passes to the heap, and notes any made from another thread
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::thread::id owner     = std::this_thread::get_id();
+    size_t          allocated = 0;
+    size_t          live      = 0;
+    bool            foreign   = false;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        foreign |= std::this_thread::get_id() != owner;
+        allocated++;
+        live++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        live--;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+int main()
+{
+    std::string source = R"(
+/*<$static if @useShadow && @quality == 2>*/
+float shadow;
+/*<$static elif @quality == 1>*/
+float low;
+/*<$static endif>*/
+/*<$dynamic if @useFog>*/
+float fog;
+/*<$dynamic endif>*/
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Context ctx;
+    ctx.isStatic  = false;
+    ctx.bools     = {{"@useShadow", true}, {"@useFog", true}};
+    ctx.ints      = {{"@quality", 2}};
+    ctx.instances = {{"@useFog", "g_fog"}};
+
+    pps::Engine  engine;
+    pps::Session session(engine);
+    auto         expected = session.process(source, &ctx);
+
+    CountingResource counting;
+    session.set_memory_resource(&counting);
+    check("same output", session.process(source, &ctx) == expected && expected.find("float shadow;") != std::string::npos);
+    check("scratch from resource", counting.allocated > 0 && counting.live == 0);
+
+    // A per-frame arena: everything of the call is dropped by one release
+    char                                buffer[64 * 1024];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    session.set_memory_resource(&arena);
+    bool arena_ok = true;
+    for (int frame = 0; frame < 100; frame++)
+    {
+        arena_ok &= session.process(source, &ctx) == expected;
+        arena.release();
+    }
+    check("monotonic arena", arena_ok);
+
+    // Helper threads of parallel regions stay on the heap
+    std::string large;
+    for (int i = 0; i < 200; i++)
+        large += source;
+    session.set_memory_resource(nullptr);
+    auto expected_large = session.process(large, &ctx);
+
+    engine.set_parallel_threshold(1);
+    counting.allocated = 0;
+    session.set_memory_resource(&counting);
+    check("parallel regions", session.process(large, &ctx) == expected_large && !counting.foreign && counting.live == 0);
+    engine.set_parallel_threshold(0);
+
+    counting.allocated = 0;
+    session.set_memory_resource(nullptr);
+    session.process(source, &ctx);
+    check("detached", counting.allocated == 0);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include <pps/engine.h>
+#include <pps/diagnostics.h>
+#include <pps/stats.h>
+#include <pps/trace.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <thread>
+
+// Counts the override directive slices it receives, and the times and threads of replayed ones
+class CountingTracer : public pps::Tracer
+{
+public:
+    size_t                    overrides = 0;
+    size_t                    replayed  = 0;
+    Clock::time_point         first     = Clock::time_point::max();
+    Clock::time_point         last      = Clock::time_point::min();
+    std::set<std::thread::id> threads;
+
+    void begin(const char*, const std::string& name) override { overrides += name == "override"; }
+    void end(const char*) override {}
+
+    void begin_at(const char* category, const std::string& name, Clock::time_point time, std::thread::id thread) override
+    {
+        begin(category, name);
+        _replayed(time, thread);
+    }
+
+    void end_at(const char* category, Clock::time_point time, std::thread::id thread) override
+    {
+        end(category);
+        _replayed(time, thread);
+    }
+
+private:
+    void _replayed(Clock::time_point time, std::thread::id thread)
+    {
+        replayed++;
+        first = std::min(first, time);
+        last  = std::max(last, time);
+        threads.insert(thread);
+    }
+};
+
+int main()
+{
+    auto dir = std::filesystem::temp_directory_path() / "pps_parallel_sample";
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "common.hlsl", std::ios::binary) << "float common;\n\n\n\n";
+    // Opens a branch that the including source closes
+    std::ofstream(dir / "open.hlsl", std::ios::binary) << "/*<$static if @useShadow>*/\n";
+
+    // Many top-level regions, with runs of empty lines at every seam
+    std::string source;
+    for (int i = 0; i < 400; i++)
+    {
+        source += "float value" + std::to_string(i) + ";\n\n\n\n";
+        source += "/*<$static if @quality != " + std::to_string(i % 4) + ">*/\n";
+        source += "{\n";
+        source += "    /*<$static if @useShadow>*/\n";
+        source += "    color *= shadow(uv);\n";
+        source += "    /*<$static else>*/\n";
+        source += "    color *= 0.5;\n";
+        source += "    /*<$static endif>*/\n";
+        source += "}\n";
+        source += "/*<$static endif>*/\n";
+        source += "SamplerState s" + std::to_string(i) + " : register(s0 /*<$override @sampler>*/);\n";
+        if (i % 50 == 0)
+            source += "/*<$include common.hlsl>*/\n";
+    }
+    auto unbalanced = source + "/*<$include open.hlsl>*/\nfloat shadowed;\n/*<$static endif>*/\n" + source;
+    // Only found unbalanced once the regions ran, so that attempt is abandoned
+    auto abandoned = source + "/*<$include open.hlsl>*/\n" + source;
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Engine sequential;
+    pps::Engine parallel;
+    parallel.set_parallel_threshold(1);
+    auto prepared = parallel.prepare(source);
+
+    for (int i = 0; i < 4; i++)
+    {
+        pps::Context ctx;
+        ctx.bools    = {{"@useShadow", (i & 1) != 0}};
+        ctx.ints     = {{"@quality", i * 2}};
+        ctx.strings  = {{"@sampler", "s" + std::to_string(i)}};
+        ctx.prefixes = {dir.generic_string() + "/"};
+
+        pps::Stats   expected_stats;
+        pps::Session expected_session(sequential);
+        expected_session.set_stats(&expected_stats);
+        auto expected = expected_session.process(source, &ctx);
+
+        pps::Stats   stats;
+        pps::Session session(parallel);
+        session.set_stats(&stats);
+        auto result = session.process(source, &ctx);
+        check("regions " + std::to_string(i), result == expected && session.dependencies() == expected_session.dependencies() &&
+                                                  stats.lines == expected_stats.lines && stats.bytes_out == expected_stats.bytes_out);
+        check("template " + std::to_string(i), session.process(*prepared, &ctx) == expected);
+
+        // A branch opened by an include spans the cut, so the call falls back to one pass
+        pps::Session fallback(parallel);
+        check("fallback " + std::to_string(i), fallback.process(unbalanced, &ctx) == expected_session.process(unbalanced, &ctx));
+    }
+
+    // The abandoned split reports nothing; only the pass that produced the output does
+    pps::Context ctx;
+    ctx.bools    = {{"@useShadow", true}};
+    ctx.ints     = {{"@quality", 1}};
+    ctx.prefixes = {dir.generic_string() + "/"};
+
+    pps::Diagnostics expected_diagnostics;
+    CountingTracer   expected_tracer;
+    pps::Session     expected_session(sequential);
+    expected_session.set_diagnostics(&expected_diagnostics);
+    expected_session.set_tracer(&expected_tracer);
+    auto expected_abandoned = expected_session.process(abandoned, &ctx);
+
+    pps::Diagnostics diagnostics;
+    CountingTracer   tracer;
+    pps::Session     fallback(parallel);
+    fallback.set_diagnostics(&diagnostics);
+    fallback.set_tracer(&tracer);
+    auto result = fallback.process(abandoned, &ctx);
+    check("fallback reports once", result == expected_abandoned && diagnostics.count(pps::DiagnosticCode::tMissingOverride) == expected_diagnostics.count(pps::DiagnosticCode::tMissingOverride) &&
+                                       diagnostics.count(pps::DiagnosticCode::tMissingOverride) > 0 && tracer.overrides == expected_tracer.overrides);
+
+    // An accepted split reports what one pass would
+    pps::Diagnostics split_diagnostics;
+    CountingTracer   split_tracer;
+    pps::Session     split(parallel);
+    split.set_diagnostics(&split_diagnostics);
+    split.set_tracer(&split_tracer);
+    auto start = pps::Tracer::Clock::now();
+    split.process(source, &ctx);
+    auto finish = pps::Tracer::Clock::now();
+    expected_diagnostics.clear();
+    expected_tracer.overrides = 0;
+    expected_session.process(source, &ctx);
+    check("split reports once", split_diagnostics.count(pps::DiagnosticCode::tMissingOverride) == expected_diagnostics.count(pps::DiagnosticCode::tMissingOverride) &&
+                                    split_tracer.overrides == expected_tracer.overrides);
+
+    // Replayed slices keep the time and thread of the work, which ran during the call
+    check("split slice times", split_tracer.replayed > 0 && split_tracer.first >= start && split_tracer.last <= finish &&
+                                   !split_tracer.threads.empty() && !split_tracer.threads.count(std::thread::id()));
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
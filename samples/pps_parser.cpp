@@ -1,6 +1,8 @@
 #include <frontend/lexer.h>
 #include <frontend/parser.h>
+#include <call_memory.h>
 
+#include <memory_resource>
 #include <vector>
 #include <iostream>
 #include <cassert>
@@ -44,6 +46,26 @@ int main()
         }
     }
 
-    std::cout << "Passed: " << passed << "/" << testCases.size() << std::endl;
-    return passed == testCases.size() ? 0 : 1;
+    // Within a call's scope, the token vector and the child vectors come from its resource
+    size_t total = testCases.size() + 1;
+    {
+        char                                buffer[16 * 1024];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        pps::MemoryScope                    scope(&arena);
+
+        std::string input = "int @x = 1\n@x > 0";
+        pps::Lexer  lexer(input);
+        auto        tokens = lexer.tokenize();
+        pps::Parser parser(tokens);
+        auto        ast      = parser.parse();
+        auto        compound = dynamic_cast<pps::StmtCompoundNode*>(ast.get());
+
+        bool scoped = tokens.get_allocator().resource() == &arena && compound && compound->statements.size() == 2 &&
+                      compound->statements.get_allocator().resource() == &arena;
+        passed += scoped;
+        std::cout << (scoped ? "[PASS] " : "[FAIL] ") << "Call resource" << std::endl;
+    }
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
 }
\ No newline at end of file
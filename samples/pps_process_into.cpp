@@ -0,0 +1,118 @@
+#include <pps/cache.h>
+#include <pps/engine.h>
+#include <filesystem>
+#include <iostream>
+
+// Keeps the pieces apart, to check what the session hands over
+class PieceSink : public pps::OutputSink
+{
+public:
+    size_t                   reserved = 0;
+    std::vector<std::string> pieces;
+
+    void reserve(size_t size) override { reserved = size; }
+
+    void append(std::string_view piece) override { pieces.emplace_back(piece); }
+
+    std::string joined() const
+    {
+        std::string out;
+        for (const auto& piece : pieces)
+            out += piece;
+        return out;
+    }
+};
+
+int main()
+{
+    std::string source = R"(
+/*<$static if @useShadow>*/
+float shadow;
+
+
+
+float softness;
+/*<$static else>*/
+float flat;
+/*<$static endif>*/
+void main()
+{
+    /*<$static if @useFog == 1>*/
+    float fog;
+    /*<$static endif>*/
+}
+)";
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Context shadow;
+    shadow.bools = {{"@useShadow", true}};
+    shadow.ints  = {{"@useFog", 1}};
+
+    pps::Context flat;
+    flat.bools = {{"@useShadow", false}};
+    flat.ints  = {{"@useFog", 0}};
+
+    pps::Engine   engine;
+    pps::Session  session(engine);
+    pps::Template prepared(source);
+
+    auto expected_shadow = session.process(source, &shadow);
+    auto expected_flat   = session.process(source, &flat);
+
+    std::string output;
+    session.process_into(output, source, &shadow);
+    check("string source", output == expected_shadow);
+
+    // The second output is smaller and fits in the buffer of the first
+    auto buffer = output.data();
+    session.process_into(output, source, &flat);
+    check("capacity reused", output == expected_flat && output.data() == buffer);
+
+    std::string from_template = "stale";
+    session.process_into(from_template, prepared, &shadow);
+    check("template source", from_template == expected_shadow);
+
+    // The template remembers its largest output and asks the sink for it up front
+    PieceSink sink;
+    session.process_into(sink, prepared, &flat);
+    check("sink output", sink.joined() == expected_flat && sink.pieces.size() > 1);
+    check("sink size hint", prepared.output_hint() == expected_shadow.size() && sink.reserved == expected_shadow.size());
+
+    engine.set_parallel_threshold(1);
+    PieceSink regions;
+    session.process_into(regions, prepared, &shadow);
+    check("sink regions", regions.joined() == expected_shadow);
+    engine.set_parallel_threshold(0);
+
+    auto dir = std::filesystem::temp_directory_path() / "pps_process_into_sample";
+    std::filesystem::remove_all(dir);
+
+    pps::Cache cache(dir.generic_string());
+    engine.set_cache(&cache);
+    PieceSink miss;
+    session.process_into(miss, prepared, &shadow);
+    PieceSink hit;
+    session.process_into(hit, prepared, &shadow);
+    check("sink cached", miss.joined() == expected_shadow && hit.joined() == expected_shadow && cache.stats().hits == 1);
+    engine.set_cache(nullptr);
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
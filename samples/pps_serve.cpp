@@ -0,0 +1,130 @@
+#include "serve.h"
+
+#include <varint.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#if !_WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if _WIN32
+int main()
+{
+    std::cout << "Unix sockets are not supported on this platform" << std::endl;
+    std::cout << "Passed: 0/0" << std::endl;
+    return 0;
+}
+#else
+static bool sendFrame(int fd, const std::string& payload)
+{
+    uint32_t size = uint32_t(payload.size());
+    char     header[4];
+    for (int i = 0; i < 4; i++)
+        header[i] = char(size >> (8 * i));
+    return ::write(fd, header, 4) == 4 && ::write(fd, payload.data(), payload.size()) == ssize_t(payload.size());
+}
+
+static bool receiveFrame(int fd, std::string& payload)
+{
+    unsigned char header[4];
+    if (::recv(fd, header, 4, MSG_WAITALL) != 4)
+        return false;
+
+    payload.resize(header[0] | header[1] << 8 | header[2] << 16 | uint32_t(header[3]) << 24);
+    return payload.empty() || ::recv(fd, payload.data(), payload.size(), MSG_WAITALL) == ssize_t(payload.size());
+}
+
+// Status byte and output or error message of the response, status 2 if the connection failed
+static std::pair<int, std::string> request(int fd, const std::string& source, const pps::Context& context, uint8_t flags = 0)
+{
+    std::string payload = {char(1), char(flags)};
+    pps::write_blob(payload, source);
+    pps::write_blob(payload, context.serialize());
+
+    std::string response;
+    if (!sendFrame(fd, payload) || !receiveFrame(fd, response) || response.empty())
+        return {2, ""};
+
+    std::string_view in = std::string_view(response).substr(1);
+    std::string_view body;
+    if (!pps::read_blob(in, body))
+        return {2, ""};
+    return {response[0], std::string(body)};
+}
+
+int main()
+{
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    auto dir = std::filesystem::temp_directory_path() / "pps_serve_sample";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "high");
+    std::filesystem::create_directories(dir / "low");
+    std::ofstream(dir / "low" / "common.hlsl", std::ios::binary) << "float low;\n";
+
+    ServeOptions options;
+    options.socketPath    = (dir / "serve.sock").string();
+    options.base.prefixes = {(dir / "high").generic_string() + "/", (dir / "low").generic_string() + "/"};
+
+    int         result = -1;
+    std::thread server([&]() { result = runServer(options); });
+
+    sockaddr_un address = {};
+    address.sun_family  = AF_UNIX;
+    options.socketPath.copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    for (int i = 0; i < 500 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    pps::Context context;
+    context.bools = {{"@useShadow", true}};
+
+    auto good = request(fd, "/*<$static if @useShadow>*/\nfloat shadow;\n/*<$static endif>*/\n", context);
+    check("request", good.first == 0 && good.second.find("float shadow;") != std::string::npos);
+
+    // The lexer throws on the unterminated string
+    auto bad = request(fd, "/*<$static if @name == \"shadow>*/\nfloat shadow;\n/*<$static endif>*/\n", context);
+    check("error response", bad.first == 1 && !bad.second.empty());
+
+    auto after = request(fd, "/*<$static if !@useShadow>*/\nfloat lit;\n/*<$static endif>*/\nfloat main;\n", context);
+    check("request after error", after.first == 0 && after.second.find("float main;") != std::string::npos && after.second.find("float lit;") == std::string::npos);
+
+    // A file in a prefix probed before the one that was included now shadows it
+    std::string include = "/*<$include common.hlsl>*/\n";
+    auto        low     = request(fd, include, context);
+    std::ofstream(dir / "high" / "common.hlsl", std::ios::binary) << "float high;\n";
+    auto high = request(fd, include, context);
+    check("shadowing include", low.second.find("float low;") != std::string::npos && high.second.find("float high;") != std::string::npos);
+
+    check("shutdown", request(fd, "", context, ServeShutdown).first == 0);
+    ::close(fd);
+    server.join();
+    check("server exit", result == 0);
+    std::filesystem::remove_all(dir);
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
+#endif
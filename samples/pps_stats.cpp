@@ -0,0 +1,107 @@
+#include <pps/stats.h>
+#include <pps/trace.h>
+#include <iostream>
+
+// Counts slices and checks that they nest
+class CheckTracer : public pps::Tracer
+{
+public:
+    std::vector<std::string> open;
+    std::vector<std::string> names;
+    bool                     nested = true;
+
+    void begin(const char* category, const std::string& name) override
+    {
+        open.push_back(category);
+        names.push_back(name);
+    }
+
+    void end(const char* category) override
+    {
+        nested = nested && !open.empty() && open.back() == category;
+        if (!open.empty())
+            open.pop_back();
+    }
+};
+
+int main()
+{
+    std::string line = R"(
+SamplerState s_LinearWrap : register(s0 /*<$override @sLinearWrap>*/);
+void main(out float4 color)
+{
+    /*<$static if @useShadow>*/
+    color.rgb *= shadow(uv);
+    /*<$static elif @quality == 2>*/
+    color.rgb *= ao(uv);
+    /*<$static endif>*/
+}
+)";
+
+    pps::Context ctx;
+    ctx.bools   = {{"@useShadow", false}};
+    ctx.ints    = {{"@quality", 2}};
+    ctx.strings = {{"@sLinearWrap", "s10"}};
+
+    int passed = 0;
+    int total  = 0;
+
+    auto check = [&](const std::string& name, bool condition) {
+        total++;
+        if (condition)
+        {
+            passed++;
+            std::cout << "[PASS] " << name << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << name << std::endl;
+        }
+    };
+
+    pps::Stats stats;
+    pps::PPS   lang;
+    lang.set_stats(&stats);
+    auto result = lang.process(line, &ctx);
+
+    std::cout << "pps stats:\n"
+              << stats.to_json() << std::endl;
+
+    check("directives", stats[pps::Directive::tStatic] == 3 && stats[pps::Directive::tOverride] == 1);
+    check("lines", stats.lines == 10);
+    check("bytes", stats.bytes_in == line.size() && stats.bytes_out == result.size());
+    check("lex and parse", stats[pps::Stage::tLex].count == 2 && stats[pps::Stage::tParse].count == 2);
+    check("evaluate", stats[pps::Stage::tEvaluate].count == 2);
+    check("scan", stats[pps::Stage::tScan].count == stats.lines);
+
+    // Stage allocations are a part of the call's, which are all zero without tracking
+    uint64_t staged = 0;
+    for (const auto& stage : stats.stages)
+        staged += stage.allocations;
+    pps::record_allocation(64);
+    check("allocations", staged <= stats.allocations && (stats.allocations == 0) == (stats.allocated_bytes == 0));
+
+    // Without own stats, calls merge into the global ones
+    pps::Stats global;
+    pps::set_global_stats(&global);
+    pps::PPS other;
+    other.process(line, &ctx);
+    other.process(line, &ctx);
+    pps::set_global_stats(nullptr);
+    check("global", global.lines == 2 * stats.lines && global[pps::Stage::tLex].count == 4);
+
+    // Nothing is measured when stats are disabled
+    pps::Stats before = stats;
+    lang.set_stats(nullptr);
+    lang.process(line, &ctx);
+    check("disabled", stats.lines == before.lines && global.lines == 2 * before.lines);
+
+    CheckTracer tracer;
+    lang.set_tracer(&tracer);
+    lang.process(line, &ctx);
+    check("trace", tracer.nested && tracer.open.empty() &&
+                       tracer.names == std::vector<std::string>{"process", "override", "static", "static", "static"});
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
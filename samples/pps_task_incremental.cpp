@@ -0,0 +1,110 @@
+#include <pps/document.h>
+#include <iostream>
+
+struct Edit
+{
+    std::string name;
+    std::string find;
+    std::string text;
+};
+
+int main()
+{
+    pps::Context ctx;
+    ctx.bools = {
+        {"@hasBaseColorMap", true},
+        {"@useBaseColorMapAlpha", false},
+        {"@useShadow", true},
+    };
+    ctx.strings = {
+        {"@sLinearWrap", "s10"},
+    };
+
+    std::string line = R"(
+SamplerState s_LinearWrap : register(s0 /*<$override @sLinearWrap>*/);
+void main(out float4 color)
+{
+    /*<$static if @hasBaseColorMap>*/
+    {
+        float4 value = texture(baseColorMap, uv);
+        color.rgb *= value.rgb;
+        /*<$static if @useBaseColorMapAlpha>*/
+        color.a *= value.a;
+        /*<$static else>*/
+        color.a *= 0.5;
+        /*<$static endif>*/
+    }
+    /*<$static endif>*/
+    /*<$static if @useShadow>*/
+    color.rgb *= 0.9f;
+    /*<$static endif>*/
+}
+)";
+
+    const std::vector<Edit> edits = {
+        {"Plain text", "0.5", "0.25"},
+        {"Insert line", "    color.rgb *= 0.9f;\n", "    color.rgb *= 0.9f;\n    color.a = 1.0;\n"},
+        {"Branch condition", "@hasBaseColorMap>", "@useBaseColorMapAlpha>"},
+        {"Remove endif", "    /*<$static endif>*/\n}", "}"},
+        {"Restore endif", "    color.a = 1.0;\n}", "    color.a = 1.0;\n    /*<$static endif>*/\n}"},
+        {"Override", "/*<$override @sLinearWrap>*/", ""},
+        {"Join lines", "uv);\n        color.rgb", "uv); color.rgb"},
+        {"Split line", "void main(out float4 color)", "void main(\n    out float4 color)"},
+        {"Same line count", "    color.rgb *= 0.9f;\n    color.a = 1.0;", "    color.rgb *= 0.8f;\n    color.a = 0.5;"},
+    };
+
+    pps::Document document(line, &ctx);
+
+    int passed = 0;
+    for (const auto& edit : edits)
+    {
+        auto offset = document.source().find(edit.find);
+        auto range = document.edit(offset, edit.find.size(), edit.text);
+
+        pps::PPS lang;
+        auto     expected = lang.process(document.source(), &ctx);
+        if (document.output() == expected)
+        {
+            passed++;
+            std::cout << "[PASS] " << edit.name << ": output [" << range.offset << ", "
+                      << range.offset + range.length << ") " << document.output() << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << edit.name << ":\n"
+                      << document.output() << "\nexpected:\n"
+                      << expected << std::endl;
+        }
+    }
+
+    const std::vector<std::string> toggles = {
+        "@useShadow",
+        "@useBaseColorMapAlpha",
+        "@hasBaseColorMap",
+        "@useBaseColorMapAlpha",
+    };
+
+    for (const auto& toggle : toggles)
+    {
+        ctx.bools[toggle] = !ctx.bools[toggle];
+        auto ranges       = document.update(toggle);
+
+        pps::PPS lang;
+        auto     expected = lang.process(document.source(), &ctx);
+        if (document.output() == expected)
+        {
+            passed++;
+            std::cout << "[PASS] Toggle " << toggle << ": " << ranges.size() << " ranges " << document.output() << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] Toggle " << toggle << ":\n"
+                      << document.output() << "\nexpected:\n"
+                      << expected << std::endl;
+        }
+    }
+
+    auto total = edits.size() + toggles.size();
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
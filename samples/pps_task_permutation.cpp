@@ -0,0 +1,130 @@
+#include <pps/engine.h>
+#include <pps/include_provider.h>
+#include <atomic>
+#include <iostream>
+
+// Counts the reads that reach the provider
+class CountingProvider : public pps::MemoryProvider
+{
+public:
+    std::atomic<int> reads = 0;
+
+    bool read(const std::string& path, const std::set<std::string>& prefixes, pps::IncludeFile& file) override
+    {
+        reads++;
+        return pps::MemoryProvider::read(path, prefixes, file);
+    }
+};
+
+int main()
+{
+    std::string line = R"(
+SamplerState s_LinearWrap : register(s0 /*<$override @sLinearWrap>*/);
+void main(out float4 color)
+{
+    /*<$static if @hasBaseColorMap>*/
+    {
+        float4 value = texture(baseColorMap, uv);
+        color.rgb *= value.rgb;
+        /*<$static if @useBaseColorMapAlpha>*/
+        color.a *= value.a;
+        /*<$static else>*/
+        color.a *= 0.5;
+        /*<$static endif>*/
+    }
+    /*<$static endif>*/
+    /*<$static if @useShadow>*/
+    color.rgb *= 0.9f;
+    /*<$static endif>*/
+}
+)";
+
+    std::vector<pps::Context> contexts;
+    for (int i = 0; i < 8; i++)
+    {
+        pps::Context ctx;
+        ctx.bools = {
+            {"@hasBaseColorMap", (i & 1) != 0},
+            {"@useBaseColorMapAlpha", (i & 2) != 0},
+            {"@useShadow", (i & 4) != 0},
+        };
+        ctx.strings = {
+            {"@sLinearWrap", "s10"},
+        };
+        contexts.push_back(ctx);
+    }
+
+    std::vector<pps::Context*> ctxs;
+    for (auto& ctx : contexts)
+        ctxs.push_back(&ctx);
+
+    pps::PPS lang;
+    auto     results = lang.process(line, ctxs);
+
+    int passed = 0;
+    for (size_t i = 0; i < contexts.size(); i++)
+    {
+        pps::PPS single;
+        auto     expected = single.process(line, &contexts[i]);
+        if (results[i] == expected)
+        {
+            passed++;
+            std::cout << "[PASS] permutation " << i << ": " << results[i] << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] permutation " << i << ":\n"
+                      << results[i] << "\nexpected:\n"
+                      << expected << std::endl;
+        }
+    }
+
+    // Paths meet again after the endif and read the include once per set of prefixes
+    std::string shared = R"(
+/*<$static if @useShadow>*/
+float shadow;
+/*<$static endif>*/
+/*<$include common.hlsl>*/
+float main;
+)";
+
+    CountingProvider provider;
+    provider.add("a/common.hlsl", "float a;\n");
+    provider.add("b/common.hlsl", "float b;\n");
+    for (size_t i = 0; i < contexts.size(); i++)
+    {
+        contexts[i].bools["@useShadow"] = (i & 1) != 0;
+        contexts[i].prefixes            = {i < 4 ? "a/" : "b/"};
+    }
+
+    pps::Engine engine;
+    engine.set_include_provider(&provider);
+    pps::Session session(engine);
+    auto         shared_results = session.process(shared, ctxs);
+    auto         reads          = provider.reads.load();
+
+    size_t shared_passed = 0;
+    for (size_t i = 0; i < contexts.size(); i++)
+    {
+        auto expected = session.process(shared, &contexts[i]);
+        if (shared_results[i] == expected && expected.find(i < 4 ? "float a;" : "float b;") != std::string::npos)
+            shared_passed++;
+        else
+            std::cout << "[FAIL] shared permutation " << i << ":\n"
+                      << shared_results[i] << "\nexpected:\n"
+                      << expected << std::endl;
+    }
+    if (shared_passed == contexts.size() && reads == 2)
+    {
+        passed++;
+        std::cout << "[PASS] shared reads" << std::endl;
+    }
+    else
+    {
+        std::cout << "[FAIL] shared reads: " << reads << std::endl;
+    }
+
+    auto total = contexts.size() + 1;
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include <pps/pps.h>
+#include <iostream>
+
+int main()
+{
+    std::string line = R"(
+SamplerState s_LinearWrap : register(s0 /*<$override @sLinearWrap>*/);
+void main(out float4 color)
+{
+    /*<$static if @isMobile>*/
+    color = float4(1.0, 1.0, 1.0, 1.0);
+    /*<$static elif @hasBaseColorMap && @quality == 2>*/
+    {
+        float4 value = texture(baseColorMap, uv);
+        color.rgb *= value.rgb;
+        /*<$static if @useBaseColorMapAlpha || @isMobile>*/
+        color.a *= value.a;
+        /*<$static else>*/
+        color.a *= 0.5;
+        /*<$static endif>*/
+    }
+    /*<$static elif @quality == 1>*/
+    color.rgb *= 0.5;
+    /*<$static else>*/
+    color.rgb *= 0.9f;
+    /*<$static endif>*/
+    /*<$static if !(@hasBaseColorMap && @useBaseColorMapAlpha)>*/
+    color.a = 1.0;
+    /*<$static endif>*/
+}
+)";
+
+    // Platform stage binds @isMobile and @quality, material stage the rest
+    pps::Context platform;
+    platform.bools = {
+        {"@isMobile", false},
+    };
+    platform.ints = {
+        {"@quality", 2},
+    };
+
+    pps::PPS lang;
+    auto     residual = lang.specialize(line, &platform);
+
+    std::cout << "pps residual:\n"
+              << residual << std::endl;
+
+    int passed = 0;
+    int total  = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        pps::Context full = platform;
+        full.bools["@hasBaseColorMap"]      = (i & 1) != 0;
+        full.bools["@useBaseColorMapAlpha"] = (i & 2) != 0;
+        full.strings["@sLinearWrap"]        = "s10";
+
+        pps::Context material;
+        material.bools   = {{"@hasBaseColorMap", full.bools["@hasBaseColorMap"]},
+                            {"@useBaseColorMapAlpha", full.bools["@useBaseColorMapAlpha"]}};
+        material.strings = full.strings;
+
+        pps::PPS staged;
+        pps::PPS direct;
+        auto     result   = staged.process(residual, &material);
+        auto     expected = direct.process(line, &full);
+
+        total++;
+        if (result == expected)
+        {
+            passed++;
+            std::cout << "[PASS] material " << i << ": " << result << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] material " << i << ":\n"
+                      << result << "\nexpected:\n"
+                      << expected << std::endl;
+        }
+    }
+
+    std::cout << "Passed: " << passed << "/" << total << std::endl;
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include <pps/stats.h>
+
+// Global allocation operators that report to record_allocation(), compiled in
+// with the enable_pps_alloc_tracking option. Where the replacement takes effect
+// depends on the platform: on ELF and Mach-O, a shared libpps interposes them for
+// the whole process, host allocations included; a Windows DLL only replaces them
+// for its own code. Counting only happens on threads running a PPS call with
+// stats attached, so the host's allocations elsewhere pass through uncounted.
+#ifdef PPS_TRACK_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+void* operator new(std::size_t size)
+{
+    pps::record_allocation(size);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    pps::record_allocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Over-aligned types go through these; the block must be freed by the matching call
+static void* aligned_malloc(std::size_t size, std::align_val_t alignment)
+{
+    auto align = static_cast<std::size_t>(alignment);
+#if _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    return std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+}
+
+static void aligned_free(void* ptr)
+{
+#if _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    pps::record_allocation(size);
+    if (void* ptr = aligned_malloc(size, alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    pps::record_allocation(size);
+    return aligned_malloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, alignment, tag);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    aligned_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    aligned_free(ptr);
+}
+
+#endif
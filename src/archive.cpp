@@ -0,0 +1,285 @@
+#include <pps/archive.h>
+#include <hash.h>
+
+#include <aclg/aclg.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pps
+{
+
+static constexpr char     g_header_magic[4] = {'P', 'P', 'S', 'A'};
+static constexpr char     g_footer_magic[4] = {'P', 'P', 'S', 'I'};
+static constexpr uint32_t g_version         = 1;
+static constexpr size_t   g_header_size     = 8;
+static constexpr size_t   g_footer_size     = 24;
+
+static_assert(sizeof(ArchiveEntry) == 32, "ArchiveEntry is read in place from the mapped file");
+
+static bool entry_less(const ArchiveEntry& entry, const Fingerprint& key)
+{
+    return entry.low != key.low ? entry.low < key.low : entry.high < key.high;
+}
+
+Fingerprint ArchiveReader::key(const Context& context)
+{
+    return context.fingerprint(false);
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    if (m_file.is_open())
+        finish();
+}
+
+bool ArchiveWriter::open(const std::string& path)
+{
+    m_file.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        ACLG_ERROR("Could not open archive {}.", path);
+        return false;
+    }
+
+    m_index.clear();
+    m_blobs.clear();
+    m_duplicates = 0;
+
+    m_file.write(g_header_magic, sizeof(g_header_magic));
+    m_file.write(reinterpret_cast<const char*>(&g_version), sizeof(g_version));
+    m_offset = g_header_size;
+    return bool(m_file);
+}
+
+bool ArchiveWriter::add(const Context& context, std::string_view output)
+{
+    return add(ArchiveReader::key(context), output);
+}
+
+bool ArchiveWriter::add(const Fingerprint& key, std::string_view output)
+{
+    auto content = Hasher().update(output).digest();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open())
+        return false;
+
+    ArchiveEntry entry = {key.low, key.high, 0, output.size()};
+
+    auto& candidates = m_blobs[content];
+    for (auto index : candidates)
+    {
+        if (_same_blob(m_index[index], output))
+        {
+            entry.offset = m_index[index].offset;
+            m_duplicates++;
+            break;
+        }
+    }
+
+    if (entry.offset == 0)
+    {
+        uint64_t size = output.size();
+        m_file.seekp(m_offset);
+        m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        m_file.write(output.data(), output.size());
+        if (!m_file)
+        {
+            ACLG_ERROR("Fail to write archive entry.");
+            return false;
+        }
+
+        entry.offset = m_offset + sizeof(size);
+        m_offset     = entry.offset + size;
+        candidates.push_back(m_index.size());
+    }
+
+    m_index.push_back(entry);
+    return true;
+}
+
+bool ArchiveWriter::finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open())
+        return false;
+
+    std::stable_sort(m_index.begin(), m_index.end(), [](const ArchiveEntry& a, const ArchiveEntry& b) {
+        return entry_less(a, {b.low, b.high});
+    });
+
+    // The first of several outputs for the same context wins; the sort keeps them in the order added
+    auto last = std::unique(m_index.begin(), m_index.end(), [](const ArchiveEntry& a, const ArchiveEntry& b) {
+        return a.low == b.low && a.high == b.high;
+    });
+    if (last != m_index.end())
+    {
+        ACLG_WARN("{} contexts were added to the archive more than once.", m_index.end() - last);
+        m_index.erase(last, m_index.end());
+    }
+
+    // Aligned so that the reader can use the index in place
+    uint64_t   index_offset = (m_offset + 7) & ~uint64_t(7);
+    const char padding[8]   = {};
+    uint64_t   count        = m_index.size();
+    m_file.seekp(m_offset);
+    m_file.write(padding, index_offset - m_offset);
+    m_file.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(ArchiveEntry));
+    m_file.write(reinterpret_cast<const char*>(&index_offset), sizeof(index_offset));
+    m_file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    m_file.write(g_footer_magic, sizeof(g_footer_magic));
+    m_file.write(reinterpret_cast<const char*>(&g_version), sizeof(g_version));
+
+    bool succeed = bool(m_file);
+    m_file.close();
+    m_blobs.clear();
+    return succeed;
+}
+
+bool ArchiveWriter::_same_blob(const ArchiveEntry& entry, std::string_view output)
+{
+    if (entry.size != output.size())
+        return false;
+
+    std::string stored(entry.size, '\0');
+    m_file.seekg(entry.offset);
+    m_file.read(stored.data(), stored.size());
+    return m_file && stored == output;
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    close();
+}
+
+bool ArchiveReader::open(const std::string& path)
+{
+    close();
+
+#if _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        ACLG_ERROR("Could not open archive {}.", path);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE        mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (mapping == nullptr)
+    {
+        ACLG_ERROR("Could not map archive {}.", path);
+        return false;
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        CloseHandle(mapping);
+        ACLG_ERROR("Could not map archive {}.", path);
+        return false;
+    }
+    m_handle = mapping;
+    m_size   = size_t(size.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        ACLG_ERROR("Could not open archive {}.", path);
+        return false;
+    }
+
+    struct stat info;
+    void*       data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+
+    if (data == MAP_FAILED)
+    {
+        ACLG_ERROR("Could not map archive {}.", path);
+        return false;
+    }
+    m_data = static_cast<const char*>(data);
+    m_size = size_t(info.st_size);
+#endif
+
+    uint64_t index_offset = 0;
+    if (m_size >= g_header_size + g_footer_size)
+    {
+        std::memcpy(&index_offset, m_data + m_size - g_footer_size, sizeof(index_offset));
+        std::memcpy(&m_count, m_data + m_size - g_footer_size + 8, sizeof(m_count));
+    }
+
+    bool valid = m_size >= g_header_size + g_footer_size &&
+                 std::memcmp(m_data, g_header_magic, sizeof(g_header_magic)) == 0 &&
+                 std::memcmp(m_data + m_size - 8, g_footer_magic, sizeof(g_footer_magic)) == 0 &&
+                 index_offset % 8 == 0 && index_offset >= g_header_size && index_offset <= m_size - g_footer_size &&
+                 (m_size - g_footer_size - index_offset) % sizeof(ArchiveEntry) == 0 &&
+                 (m_size - g_footer_size - index_offset) / sizeof(ArchiveEntry) == m_count;
+    if (!valid)
+    {
+        ACLG_ERROR("{} is not a valid archive.", path);
+        close();
+        return false;
+    }
+
+    m_index = reinterpret_cast<const ArchiveEntry*>(m_data + index_offset);
+    return true;
+}
+
+void ArchiveReader::close()
+{
+    if (m_data != nullptr)
+    {
+#if _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_handle);
+#else
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    m_data   = nullptr;
+    m_size   = 0;
+    m_index  = nullptr;
+    m_count  = 0;
+    m_handle = nullptr;
+}
+
+bool ArchiveReader::find(const Context& context, std::string_view& output) const
+{
+    return find(key(context), output);
+}
+
+bool ArchiveReader::find(const Fingerprint& key, std::string_view& output) const
+{
+    auto end  = m_index + m_count;
+    auto iter = std::lower_bound(m_index, end, key, entry_less);
+    if (iter == end || iter->low != key.low || iter->high != key.high)
+        return false;
+
+    if (iter->offset > m_size || iter->size > m_size - iter->offset)
+        return false;
+
+    output = std::string_view(m_data + iter->offset, iter->size);
+    return true;
+}
+
+} // namespace pps
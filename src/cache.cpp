@@ -0,0 +1,453 @@
+#include <pps/cache.h>
+#include <pps/include_provider.h>
+#include <hash.h>
+
+#include <sbin/loader.h>
+
+#include <aclg/aclg.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace pps
+{
+
+static const std::string g_loader_prefix = "@loader/";
+
+static constexpr size_t g_max_manifest_entries = 64;
+
+// Variables read, files included and include candidates missed by one stored output
+struct CacheEntry
+{
+    std::vector<std::string> reads;
+    std::vector<std::string> dependencies;
+    std::vector<std::string> misses;
+
+    bool operator==(const CacheEntry&) const = default;
+};
+
+// Reads into `content` in place, so that a reused output string keeps its capacity
+static bool read_file(const fs::path& path, std::string& content)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+        return false;
+
+    auto size = stream.tellg();
+    if (size < 0)
+        return false;
+
+    content.resize(size_t(size));
+    stream.seekg(0);
+    return bool(stream.read(content.data(), size));
+}
+
+static uint64_t file_size_or_zero(const fs::path& path)
+{
+    std::error_code ec;
+    auto            size = fs::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+static bool write_file_atomic(const fs::path& path, const std::string& content)
+{
+    static std::atomic<uint64_t> g_counter = 0;
+
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    // Unique per process and thread, so concurrent writers never share a temporary
+    auto salt = Hasher()
+                    .update(std::random_device{}())
+                    .update(std::hash<std::thread::id>{}(std::this_thread::get_id()))
+                    .update(g_counter++)
+                    .digest();
+
+    auto temp = path;
+    temp += ".tmp" + Hasher::to_hex(salt);
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream.write(content.data(), content.size()))
+        {
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+
+    fs::rename(temp, path, ec);
+    if (ec)
+    {
+        fs::remove(temp, ec);
+        return false;
+    }
+
+    return true;
+}
+
+static bool read_dependency(const std::string& path, IncludeProvider* provider, sbin::Loader* module_loader, const std::string& decrypt_key, std::string& content)
+{
+    if (provider)
+    {
+        std::shared_ptr<const std::string> shared;
+        if (!provider->read_dependency(path, shared))
+            return false;
+
+        content = *shared;
+        return true;
+    }
+
+    if (path.rfind(g_loader_prefix, 0) != 0)
+        return read_file(path, content);
+
+    if (module_loader == nullptr)
+        return false;
+
+    auto data = module_loader->get_shader(path.substr(g_loader_prefix.size()), decrypt_key);
+    if (data == nullptr)
+        return false;
+
+    content.assign(data->data.begin(), data->data.end());
+    return true;
+}
+
+// Whether an include candidate that was missed before can be read now
+static bool dependency_exists(const std::string& path, IncludeProvider* provider, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    if (provider)
+    {
+        std::shared_ptr<const std::string> shared;
+        return provider->read_dependency(path, shared);
+    }
+
+    if (path.rfind(g_loader_prefix, 0) == 0)
+        return module_loader && module_loader->get_shader(path.substr(g_loader_prefix.size()), decrypt_key) != nullptr;
+
+    std::error_code ec;
+    return fs::exists(path, ec);
+}
+
+static uint64_t source_key(const std::string& source, const Context& context)
+{
+    Hasher hasher;
+    hasher.update(source);
+    hasher.update(uint64_t(context.isStatic));
+    for (const auto& prefix : context.prefixes)
+        hasher.update(prefix);
+    return hasher.digest();
+}
+
+bool Cache::_dependency_hash(const std::string& path, IncludeProvider* provider, sbin::Loader* module_loader, const std::string& decrypt_key, uint64_t& hash)
+{
+    std::string content;
+    if (provider || path.rfind(g_loader_prefix, 0) == 0)
+    {
+        if (!read_dependency(path, provider, module_loader, decrypt_key, content))
+            return false;
+
+        hash = Hasher().update(content).digest();
+        return true;
+    }
+
+    std::error_code ec;
+    auto            time = fs::last_write_time(path, ec);
+    if (ec)
+        return false;
+    auto size = fs::file_size(path, ec);
+    if (ec)
+        return false;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(m_hash_mutex);
+
+        auto iter = m_hashes.find(path);
+        if (iter != m_hashes.end() && iter->second.time == time && iter->second.size == size)
+        {
+            hash = iter->second.hash;
+            return true;
+        }
+    }
+
+    if (!read_file(path, content))
+        return false;
+
+    hash = Hasher().update(content).digest();
+
+    std::unique_lock<std::shared_mutex> lock(m_hash_mutex);
+    m_hashes[path] = {time, size, hash};
+    return true;
+}
+
+bool Cache::_entry_key(uint64_t           base,
+                       const Context&     context,
+                       const CacheEntry&  entry,
+                       IncludeProvider*   provider,
+                       sbin::Loader*      module_loader,
+                       const std::string& decrypt_key,
+                       uint64_t&          key)
+{
+    // A candidate that appeared would now shadow a lower-priority prefix or resolve a missing include
+    for (const auto& path : entry.misses)
+    {
+        if (dependency_exists(path, provider, module_loader, decrypt_key))
+            return false;
+    }
+
+    Hasher hasher(base);
+    for (const auto& name : entry.reads)
+    {
+        hasher.update(name);
+
+        auto bool_iter = context.bools.find(name);
+        hasher.update(bool_iter == context.bools.end() ? 2 : uint64_t(bool_iter->second));
+
+        auto int_iter = context.ints.find(name);
+        hasher.update(int_iter == context.ints.end() ? 0 : 1);
+        hasher.update(int_iter == context.ints.end() ? 0 : uint64_t(int_iter->second));
+
+        auto str_iter = context.strings.find(name);
+        hasher.update(str_iter == context.strings.end() ? 0 : 1);
+        hasher.update(str_iter == context.strings.end() ? "" : str_iter->second);
+
+        auto instance_iter = context.instances.find(name);
+        hasher.update(instance_iter == context.instances.end() ? 0 : 1);
+        hasher.update(instance_iter == context.instances.end() ? "" : instance_iter->second);
+    }
+
+    // Merkle style: the key depends on the hash of every included file
+    for (const auto& path : entry.dependencies)
+    {
+        uint64_t hash;
+        if (!_dependency_hash(path, provider, module_loader, decrypt_key, hash))
+            return false;
+
+        hasher.update(path);
+        hasher.update(hash);
+    }
+
+    key = hasher.digest();
+    return true;
+}
+
+static std::vector<CacheEntry> read_manifest(const fs::path& path)
+{
+    std::vector<CacheEntry> entries;
+
+    std::string content;
+    if (!read_file(path, content))
+        return entries;
+
+    std::istringstream iss(content);
+    std::string        line;
+    while (std::getline(iss, line))
+    {
+        if (line == "entry")
+            entries.emplace_back();
+        else if (entries.empty())
+            continue;
+        else if (line.rfind("r ", 0) == 0)
+            entries.back().reads.push_back(line.substr(2));
+        else if (line.rfind("d ", 0) == 0)
+            entries.back().dependencies.push_back(line.substr(2));
+        else if (line.rfind("m ", 0) == 0)
+            entries.back().misses.push_back(line.substr(2));
+    }
+
+    return entries;
+}
+
+static std::string write_manifest(const std::vector<CacheEntry>& entries)
+{
+    std::string content;
+    for (const auto& entry : entries)
+    {
+        content += "entry\n";
+        for (const auto& name : entry.reads)
+            content += "r " + name + "\n";
+        for (const auto& path : entry.dependencies)
+            content += "d " + path + "\n";
+        for (const auto& path : entry.misses)
+            content += "m " + path + "\n";
+    }
+    return content;
+}
+
+Cache::Cache(const std::string& directory, uint64_t max_bytes) :
+    m_directory(directory), m_max_bytes(max_bytes)
+{
+    std::error_code ec;
+    fs::create_directories(m_directory, ec);
+
+    uint64_t bytes = 0;
+    for (auto iter = fs::recursive_directory_iterator(m_directory, ec); !ec && iter != fs::recursive_directory_iterator(); iter.increment(ec))
+    {
+        if (iter->is_regular_file(ec))
+            bytes += iter->file_size(ec);
+    }
+    m_bytes = bytes;
+}
+
+static fs::path cache_path(const std::string& directory, uint64_t key, const char* extension)
+{
+    auto hex = Hasher::to_hex(key);
+    return fs::path(directory) / hex.substr(0, 2) / (hex + extension);
+}
+
+bool Cache::lookup(const std::string&        source,
+                   const Context&            context,
+                   sbin::Loader*             module_loader,
+                   const std::string&        decrypt_key,
+                   std::string&              output,
+                   std::vector<std::string>* dependencies,
+                   IncludeProvider*          provider,
+                   std::vector<std::string>* misses)
+{
+    auto base = source_key(source, context);
+    for (const auto& entry : read_manifest(cache_path(m_directory, base, ".manifest")))
+    {
+        uint64_t key;
+        if (!_entry_key(base, context, entry, provider, module_loader, decrypt_key, key))
+            continue;
+
+        auto path = cache_path(m_directory, key, ".out");
+        if (!read_file(path, output))
+            continue;
+
+        // Refresh the entry for least recently used eviction
+        std::error_code ec;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+        if (dependencies)
+            *dependencies = entry.dependencies;
+        if (misses)
+            *misses = entry.misses;
+
+        m_hits++;
+        return true;
+    }
+
+    m_misses++;
+    return false;
+}
+
+void Cache::store(const std::string&              source,
+                  const Context&                  context,
+                  const std::vector<std::string>& reads,
+                  const std::vector<std::string>& dependencies,
+                  const std::vector<std::string>& misses,
+                  sbin::Loader*                   module_loader,
+                  const std::string&              decrypt_key,
+                  const std::string&              output,
+                  IncludeProvider*                provider)
+{
+    CacheEntry entry;
+    entry.reads = reads;
+    std::sort(entry.reads.begin(), entry.reads.end());
+    entry.reads.erase(std::unique(entry.reads.begin(), entry.reads.end()), entry.reads.end());
+    for (const auto& path : dependencies)
+    {
+        if (std::find(entry.dependencies.begin(), entry.dependencies.end(), path) == entry.dependencies.end())
+            entry.dependencies.push_back(path);
+    }
+    for (const auto& path : misses)
+    {
+        if (std::find(entry.misses.begin(), entry.misses.end(), path) == entry.misses.end())
+            entry.misses.push_back(path);
+    }
+
+    auto     base = source_key(source, context);
+    uint64_t key;
+    if (!_entry_key(base, context, entry, provider, module_loader, decrypt_key, key))
+        return;
+
+    // Overwritten files only add the difference to the tracked size
+    auto output_path = cache_path(m_directory, key, ".out");
+    auto old_size    = file_size_or_zero(output_path);
+    if (!write_file_atomic(output_path, output))
+    {
+        ACLG_WARN("Fail to write cache entry to {}.", m_directory);
+        return;
+    }
+    m_bytes += output.size();
+    m_bytes -= old_size;
+    m_stores++;
+
+    auto manifest_path = cache_path(m_directory, base, ".manifest");
+    auto entries       = read_manifest(manifest_path);
+    if (std::find(entries.begin(), entries.end(), entry) == entries.end())
+    {
+        entries.insert(entries.begin(), std::move(entry));
+        if (entries.size() > g_max_manifest_entries)
+            entries.resize(g_max_manifest_entries);
+
+        auto content = write_manifest(entries);
+        old_size     = file_size_or_zero(manifest_path);
+        if (write_file_atomic(manifest_path, content))
+        {
+            m_bytes += content.size();
+            m_bytes -= old_size;
+        }
+    }
+
+    if (m_bytes > m_max_bytes)
+        evict();
+}
+
+CacheStats Cache::stats() const
+{
+    CacheStats stats;
+    stats.hits      = m_hits;
+    stats.misses    = m_misses;
+    stats.stores    = m_stores;
+    stats.evictions = m_evictions;
+    stats.bytes     = m_bytes;
+    return stats;
+}
+
+void Cache::evict()
+{
+    struct File
+    {
+        fs::path           path;
+        fs::file_time_type time;
+        uint64_t           size;
+    };
+
+    std::vector<File> files;
+    uint64_t          bytes = 0;
+
+    std::error_code ec;
+    for (auto iter = fs::recursive_directory_iterator(m_directory, ec); !ec && iter != fs::recursive_directory_iterator(); iter.increment(ec))
+    {
+        if (!iter->is_regular_file(ec))
+            continue;
+
+        File file{iter->path(), iter->last_write_time(ec), iter->file_size(ec)};
+        bytes += file.size;
+        files.push_back(std::move(file));
+    }
+
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.time < b.time; });
+
+    // Leave some headroom so that eviction does not run on every store
+    auto target = m_max_bytes - m_max_bytes / 8;
+    for (const auto& file : files)
+    {
+        if (bytes <= target)
+            break;
+
+        if (fs::remove(file.path, ec))
+        {
+            bytes -= file.size;
+            m_evictions++;
+        }
+    }
+
+    m_bytes = bytes;
+}
+
+} // namespace pps
@@ -0,0 +1,373 @@
+#include <pps/pps.h>
+#include <pps/layered_context.h>
+#include <hash.h>
+#include <varint.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace pps
+{
+
+static constexpr char     g_magic[4] = {'P', 'P', 'S', 'C'};
+static constexpr uint8_t  g_version  = 1;
+static constexpr uint64_t g_low_seed  = 0x6a09e667f3bcc908ull;
+static constexpr uint64_t g_high_seed = 0xbb67ae8584caa73bull;
+
+enum class ContextField : uint8_t
+{
+    tBool,
+    tInt,
+    tString,
+    tInstance,
+    tPrefix,
+};
+
+// Fingerprints sum the hash of each entry, which keeps them independent of the map order
+static void add_entry(Fingerprint& fingerprint, ContextField field, std::string_view key, std::string_view value)
+{
+    fingerprint.low += Hasher(g_low_seed).update(uint64_t(field)).update(key).update(value).digest();
+    fingerprint.high += Hasher(g_high_seed).update(uint64_t(field)).update(key).update(value).digest();
+}
+
+static void add_entry(Fingerprint& fingerprint, ContextField field, std::string_view key, int64_t value)
+{
+    fingerprint.low += Hasher(g_low_seed).update(uint64_t(field)).update(key).update(uint64_t(value)).digest();
+    fingerprint.high += Hasher(g_high_seed).update(uint64_t(field)).update(key).update(uint64_t(value)).digest();
+}
+
+static void remove_entry(Fingerprint& fingerprint, ContextField field, std::string_view key, std::string_view value)
+{
+    fingerprint.low -= Hasher(g_low_seed).update(uint64_t(field)).update(key).update(value).digest();
+    fingerprint.high -= Hasher(g_high_seed).update(uint64_t(field)).update(key).update(value).digest();
+}
+
+static void remove_entry(Fingerprint& fingerprint, ContextField field, std::string_view key, int64_t value)
+{
+    fingerprint.low -= Hasher(g_low_seed).update(uint64_t(field)).update(key).update(uint64_t(value)).digest();
+    fingerprint.high -= Hasher(g_high_seed).update(uint64_t(field)).update(key).update(uint64_t(value)).digest();
+}
+
+static Fingerprint entry_sum(const Context& context, bool prefixes = true)
+{
+    Fingerprint sum;
+    for (const auto& [key, value] : context.bools)
+        add_entry(sum, ContextField::tBool, key, int64_t(value));
+    for (const auto& [key, value] : context.ints)
+        add_entry(sum, ContextField::tInt, key, int64_t(value));
+    for (const auto& [key, value] : context.strings)
+        add_entry(sum, ContextField::tString, key, value);
+    for (const auto& [key, value] : context.instances)
+        add_entry(sum, ContextField::tInstance, key, value);
+    if (prefixes)
+    {
+        for (const auto& prefix : context.prefixes)
+            add_entry(sum, ContextField::tPrefix, prefix, "");
+    }
+    return sum;
+}
+
+static Fingerprint finish_fingerprint(const Fingerprint& sum, bool is_static)
+{
+    Fingerprint fingerprint;
+    fingerprint.low  = Hasher(g_low_seed).update(sum.low).update(sum.high).update(uint64_t(is_static)).digest();
+    fingerprint.high = Hasher(g_high_seed).update(sum.high).update(sum.low).update(uint64_t(is_static)).digest();
+    return fingerprint;
+}
+
+Fingerprint Context::fingerprint(bool prefixes) const
+{
+    return finish_fingerprint(entry_sum(*this, prefixes), isStatic);
+}
+
+static bool read_string(std::string_view& in, std::string& str)
+{
+    std::string_view blob;
+    if (!read_blob(in, blob))
+        return false;
+
+    str.assign(blob);
+    return true;
+}
+
+template <typename Map>
+static std::vector<const typename Map::value_type*> sorted_entries(const Map& map)
+{
+    std::vector<const typename Map::value_type*> entries;
+    entries.reserve(map.size());
+    for (const auto& entry : map)
+        entries.push_back(&entry);
+
+    std::sort(entries.begin(), entries.end(), [](auto a, auto b) { return a->first < b->first; });
+    return entries;
+}
+
+std::string Context::serialize() const
+{
+    std::string out(g_magic, sizeof(g_magic));
+    out += char(g_version);
+    out += char(isStatic);
+
+    write_varint(out, bools.size());
+    for (auto entry : sorted_entries(bools))
+    {
+        write_blob(out, entry->first);
+        out += char(entry->second);
+    }
+
+    // Zigzag keeps small negative ints short
+    write_varint(out, ints.size());
+    for (auto entry : sorted_entries(ints))
+    {
+        write_blob(out, entry->first);
+        int64_t value = entry->second;
+        write_varint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+    }
+
+    write_varint(out, strings.size());
+    for (auto entry : sorted_entries(strings))
+    {
+        write_blob(out, entry->first);
+        write_blob(out, entry->second);
+    }
+
+    write_varint(out, instances.size());
+    for (auto entry : sorted_entries(instances))
+    {
+        write_blob(out, entry->first);
+        write_blob(out, entry->second);
+    }
+
+    write_varint(out, prefixes.size());
+    for (const auto& prefix : prefixes)
+        write_blob(out, prefix);
+
+    return out;
+}
+
+bool Context::deserialize(std::string_view data)
+{
+    if (data.size() < sizeof(g_magic) + 2 || data.substr(0, sizeof(g_magic)) != std::string_view(g_magic, sizeof(g_magic)) ||
+        uint8_t(data[sizeof(g_magic)]) != g_version)
+        return false;
+
+    Context context;
+    context.isStatic = data[sizeof(g_magic) + 1] != 0;
+    data.remove_prefix(sizeof(g_magic) + 2);
+
+    uint64_t    count;
+    std::string key;
+    std::string value;
+
+    if (!read_varint(data, count))
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (!read_string(data, key) || data.empty())
+            return false;
+        context.bools[key] = data.front() != 0;
+        data.remove_prefix(1);
+    }
+
+    if (!read_varint(data, count))
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t zigzag;
+        if (!read_string(data, key) || !read_varint(data, zigzag))
+            return false;
+        context.ints[key] = int(int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1));
+    }
+
+    if (!read_varint(data, count))
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (!read_string(data, key) || !read_string(data, value))
+            return false;
+        context.strings[key] = value;
+    }
+
+    if (!read_varint(data, count))
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (!read_string(data, key) || !read_string(data, value))
+            return false;
+        context.instances[key] = value;
+    }
+
+    if (!read_varint(data, count))
+        return false;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (!read_string(data, key))
+            return false;
+        context.prefixes.insert(key);
+    }
+
+    if (!data.empty())
+        return false;
+
+    *this = std::move(context);
+    return true;
+}
+
+LayeredContext::LayeredContext(std::shared_ptr<const Context> base)
+{
+    auto shared     = std::make_shared<Base>();
+    shared->sum     = entry_sum(*base);
+    shared->context = std::move(base);
+    m_base          = std::move(shared);
+}
+
+void LayeredContext::set_bool(const std::string& name, bool value)
+{
+    m_layer.bools[name] = value;
+}
+
+void LayeredContext::set_int(const std::string& name, int value)
+{
+    m_layer.ints[name] = value;
+}
+
+void LayeredContext::set_string(const std::string& name, const std::string& value)
+{
+    m_layer.strings[name] = value;
+}
+
+void LayeredContext::set_instance(const std::string& name, const std::string& value)
+{
+    m_layer.instances[name] = value;
+}
+
+void LayeredContext::add_prefix(const std::string& prefix)
+{
+    if (!m_base->context->prefixes.count(prefix))
+        m_layer.prefixes.insert(prefix);
+}
+
+void LayeredContext::set_static(bool is_static)
+{
+    m_static = is_static;
+}
+
+template <typename Map>
+static const typename Map::mapped_type* find_layered(const Map& layer, const Map& base, const std::string& name)
+{
+    if (auto iter = layer.find(name); iter != layer.end())
+        return &iter->second;
+    if (auto iter = base.find(name); iter != base.end())
+        return &iter->second;
+    return nullptr;
+}
+
+const bool* LayeredContext::find_bool(const std::string& name) const
+{
+    return find_layered(m_layer.bools, m_base->context->bools, name);
+}
+
+const int* LayeredContext::find_int(const std::string& name) const
+{
+    return find_layered(m_layer.ints, m_base->context->ints, name);
+}
+
+const std::string* LayeredContext::find_string(const std::string& name) const
+{
+    return find_layered(m_layer.strings, m_base->context->strings, name);
+}
+
+const std::string* LayeredContext::find_instance(const std::string& name) const
+{
+    return find_layered(m_layer.instances, m_base->context->instances, name);
+}
+
+bool LayeredContext::is_static() const
+{
+    return m_static.value_or(m_base->context->isStatic);
+}
+
+// Swap the hashes of the entries the layer replaces for the hashes of its own
+template <typename Map>
+static void layer_sum(Fingerprint& sum, ContextField field, const Map& layer, const Map& base)
+{
+    for (const auto& [key, value] : layer)
+    {
+        if (auto iter = base.find(key); iter != base.end())
+        {
+            if constexpr (std::is_same_v<typename Map::mapped_type, std::string>)
+                remove_entry(sum, field, key, iter->second);
+            else
+                remove_entry(sum, field, key, int64_t(iter->second));
+        }
+
+        if constexpr (std::is_same_v<typename Map::mapped_type, std::string>)
+            add_entry(sum, field, key, value);
+        else
+            add_entry(sum, field, key, int64_t(value));
+    }
+}
+
+Fingerprint LayeredContext::fingerprint() const
+{
+    const auto& base = *m_base->context;
+    auto        sum  = m_base->sum;
+    layer_sum(sum, ContextField::tBool, m_layer.bools, base.bools);
+    layer_sum(sum, ContextField::tInt, m_layer.ints, base.ints);
+    layer_sum(sum, ContextField::tString, m_layer.strings, base.strings);
+    layer_sum(sum, ContextField::tInstance, m_layer.instances, base.instances);
+    for (const auto& prefix : m_layer.prefixes)
+        add_entry(sum, ContextField::tPrefix, prefix, "");
+    return finish_fingerprint(sum, is_static());
+}
+
+Context LayeredContext::flatten() const
+{
+    Context context = *m_base->context;
+    apply(context);
+    return context;
+}
+
+template <typename Map>
+static void apply_layer(Map& target, const Map& layer)
+{
+    for (const auto& [key, value] : layer)
+        target[key] = value;
+}
+
+void LayeredContext::apply(Context& target) const
+{
+    apply_layer(target.bools, m_layer.bools);
+    apply_layer(target.ints, m_layer.ints);
+    apply_layer(target.strings, m_layer.strings);
+    apply_layer(target.instances, m_layer.instances);
+    target.prefixes.insert(m_layer.prefixes.begin(), m_layer.prefixes.end());
+    target.isStatic = is_static();
+}
+
+template <typename Map>
+static void revert_layer(Map& target, const Map& layer, const Map& base)
+{
+    for (const auto& entry : layer)
+    {
+        if (auto iter = base.find(entry.first); iter != base.end())
+            target[entry.first] = iter->second;
+        else
+            target.erase(entry.first);
+    }
+}
+
+void LayeredContext::revert(Context& target) const
+{
+    const auto& base = *m_base->context;
+    revert_layer(target.bools, m_layer.bools, base.bools);
+    revert_layer(target.ints, m_layer.ints, base.ints);
+    revert_layer(target.strings, m_layer.strings, base.strings);
+    revert_layer(target.instances, m_layer.instances, base.instances);
+    for (const auto& prefix : m_layer.prefixes)
+        target.prefixes.erase(prefix);
+    target.isStatic = base.isStatic;
+}
+
+} // namespace pps
@@ -0,0 +1,143 @@
+#include <pps/diagnostics.h>
+#include <format.h>
+
+#include <algorithm>
+
+namespace pps
+{
+
+static std::string location_key(const Diagnostic& diagnostic)
+{
+    auto key = std::to_string(size_t(diagnostic.code)) + ':' + std::to_string(diagnostic.line) + ':';
+    key += diagnostic.file;
+    return key;
+}
+
+void Diagnostics::set_messages(bool messages)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages = messages;
+}
+
+bool Diagnostics::accept(const Diagnostic& diagnostic)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        code = size_t(diagnostic.code);
+    m_counts[code]++;
+
+    auto key  = location_key(diagnostic);
+    auto iter = m_index.find(key);
+    if (iter != m_index.end())
+    {
+        m_entries[iter->second].count++;
+        return false;
+    }
+    if (m_kept[code] >= m_limit)
+    {
+        m_suppressed++;
+        return false;
+    }
+
+    // Reserve the location, so that concurrent repeats are counted while the message is formatted
+    m_kept[code]++;
+    m_index.emplace(std::move(key), m_entries.size());
+    m_entries.push_back(diagnostic);
+    return m_messages;
+}
+
+void Diagnostics::report(Diagnostic diagnostic)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        iter = m_index.find(location_key(diagnostic));
+    if (iter == m_index.end())
+        return;
+
+    m_entries[iter->second].message = std::move(diagnostic.message);
+}
+
+std::vector<Diagnostic> Diagnostics::entries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries;
+}
+
+uint64_t Diagnostics::count(DiagnosticCode code) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counts[size_t(code)];
+}
+
+uint64_t Diagnostics::suppressed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_suppressed;
+}
+
+void Diagnostics::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    std::fill(std::begin(m_counts), std::end(m_counts), 0);
+    std::fill(std::begin(m_kept), std::end(m_kept), 0);
+    m_suppressed = 0;
+}
+
+std::string Diagnostics::to_json() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::string out = "{\n  \"diagnostics\": [";
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        const auto& entry = m_entries[i];
+        out += i ? ",\n    {" : "\n    {";
+        out += "\"code\": \"" + std::string(name(entry.code)) + "\"";
+        out += ", \"severity\": \"" + std::string(entry.severity == Severity::tWarning ? "warning" : "error") + "\"";
+        out += ", \"file\": ";
+        append_json_string(out, entry.file);
+        out += ", \"line\": " + std::to_string(entry.line);
+        out += ", \"count\": " + std::to_string(entry.count);
+        out += ", \"message\": ";
+        append_json_string(out, entry.message);
+        out += "}";
+    }
+    out += m_entries.empty() ? "],\n" : "\n  ],\n";
+    out += "  \"suppressed\": " + std::to_string(m_suppressed) + "\n}";
+    return out;
+}
+
+const char* Diagnostics::name(DiagnosticCode code)
+{
+    switch (code)
+    {
+        case DiagnosticCode::tIncludeNotFound:
+            return "include_not_found";
+        case DiagnosticCode::tIncludeCycle:
+            return "include_cycle";
+        case DiagnosticCode::tUndefinedVariable:
+            return "undefined_variable";
+        case DiagnosticCode::tMissingOverride:
+            return "missing_override";
+        case DiagnosticCode::tInvalidVariableType:
+            return "invalid_variable_type";
+        case DiagnosticCode::tUnknownOperator:
+            return "unknown_operator";
+        case DiagnosticCode::tUnsupportedOperator:
+            return "unsupported_operator";
+        case DiagnosticCode::tUnknownNode:
+            return "unknown_node";
+        case DiagnosticCode::tUndefinedToken:
+            return "undefined_token";
+        case DiagnosticCode::tInvalidNumber:
+            return "invalid_number";
+        case DiagnosticCode::tUnterminatedString:
+            return "unterminated_string";
+        case DiagnosticCode::tSyntax:
+            return "syntax";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace pps
@@ -0,0 +1,46 @@
+#include <pps/document.h>
+#include <incremental.h>
+
+namespace pps
+{
+
+Document::Document(const std::string& source, Context* context)
+{
+    Task origin;
+    origin.set_ctx(context);
+    m_task = new IncrementalTask(source, origin);
+}
+
+Document::Document(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    Task origin;
+    origin.set_ctx(context, module_loader, decrypt_key);
+    m_task = new IncrementalTask(source, origin);
+}
+
+Document::~Document()
+{
+    delete m_task;
+}
+
+const std::string& Document::source() const
+{
+    return m_task->source();
+}
+
+const std::string& Document::output() const
+{
+    return m_task->output();
+}
+
+Range Document::edit(size_t offset, size_t length, const std::string& text)
+{
+    return m_task->edit(offset, length, text);
+}
+
+std::vector<Range> Document::update(const std::string& variable)
+{
+    return m_task->update(variable);
+}
+
+} // namespace pps
@@ -0,0 +1,103 @@
+#include <pps/engine.h>
+#include <task.h>
+
+#include <algorithm>
+
+namespace pps
+{
+
+Template::Template(std::string source) :
+    m_source(std::move(source))
+{
+    // Same line breaks as std::getline: no empty line after a trailing newline
+    size_t offset = 0;
+    while (offset < m_source.size())
+    {
+        auto end = m_source.find('\n', offset);
+        if (end == std::string::npos)
+            end = m_source.size();
+
+        Line line;
+        line.offset    = offset;
+        line.size      = end - offset;
+        line.directive = Task::has_task(m_source.substr(offset, line.size));
+        m_lines.push_back(line);
+
+        std::string path;
+        if (line.directive && Task::extract_include(m_source.substr(offset, line.size), path) &&
+            std::find(m_includes.begin(), m_includes.end(), path) == m_includes.end())
+            m_includes.push_back(std::move(path));
+
+        offset = end + 1;
+    }
+}
+
+std::string_view Template::line(size_t index) const
+{
+    const auto& line = m_lines[index];
+    return std::string_view(m_source).substr(line.offset, line.size);
+}
+
+void Template::record_output(size_t size) const
+{
+    auto hint = m_output_hint.load(std::memory_order_relaxed);
+    while (size > hint && !m_output_hint.compare_exchange_weak(hint, size, std::memory_order_relaxed))
+        ;
+}
+
+void Engine::set_cache(Cache* cache)
+{
+    m_cache = cache;
+}
+
+void Engine::set_file_cache(FileCache* files)
+{
+    m_files = files;
+}
+
+void Engine::set_include_provider(IncludeProvider* provider)
+{
+    m_provider = provider;
+}
+
+void Engine::set_stats(Stats* stats)
+{
+    m_stats = stats;
+}
+
+void Engine::set_tracer(Tracer* tracer)
+{
+    m_tracer = tracer;
+}
+
+void Engine::set_diagnostics(DiagnosticSink* diagnostics)
+{
+    m_diagnostics = diagnostics;
+}
+
+void Engine::set_executor(Executor* executor)
+{
+    m_executor = executor;
+}
+
+void Engine::set_parallel_threshold(size_t bytes)
+{
+    m_parallel = bytes;
+}
+
+void Engine::set_include_once(bool once)
+{
+    m_once = once;
+}
+
+void Engine::set_include_memo(bool memo)
+{
+    m_memo = memo;
+}
+
+std::shared_ptr<const Template> Engine::prepare(std::string source) const
+{
+    return std::make_shared<const Template>(std::move(source));
+}
+
+} // namespace pps
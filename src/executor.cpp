@@ -0,0 +1,62 @@
+#include <pps/executor.h>
+
+#include <algorithm>
+
+namespace pps
+{
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < threads; i++)
+        m_threads.emplace_back([this]() { _run(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_ready.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_ready.notify_one();
+}
+
+void ThreadPool::_run()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_ready.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+Executor& default_executor()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+} // namespace pps
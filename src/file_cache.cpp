@@ -0,0 +1,59 @@
+#include <pps/file_cache.h>
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace pps
+{
+
+std::shared_ptr<const std::string> FileCache::read(const std::string& path)
+{
+    fs::file_time_type time;
+    uintmax_t          size = 0;
+    if (m_validate)
+    {
+        std::error_code ec;
+        time = fs::last_write_time(path, ec);
+        if (!ec)
+            size = fs::file_size(path, ec);
+        if (ec)
+            time = {};
+    }
+
+    {
+        std::shared_lock lock(m_mutex);
+
+        auto iter = m_files.find(path);
+        if (iter != m_files.end() && (!m_validate || (iter->second.time == time && iter->second.size == size)))
+            return iter->second.content;
+    }
+
+    CachedFile file = {nullptr, time, size};
+
+    std::ifstream stream(path, std::ios::binary);
+    if (stream)
+    {
+        std::ostringstream buffer;
+        buffer << stream.rdbuf();
+        file.content = std::make_shared<const std::string>(buffer.str());
+    }
+
+    std::unique_lock lock(m_mutex);
+    if (!m_validate)
+        return m_files.try_emplace(path, std::move(file)).first->second.content;
+
+    auto& cached = m_files[path];
+    cached       = std::move(file);
+    return cached.content;
+}
+
+void FileCache::clear()
+{
+    std::unique_lock lock(m_mutex);
+    m_files.clear();
+}
+
+} // namespace pps
@@ -0,0 +1,140 @@
+#include <format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+namespace pps
+{
+static int count_blank(const std::string& str)
+{
+    size_t firstNonTab = str.find_first_not_of(' ');
+    if (firstNonTab == std::string::npos)
+    {
+        return str.length();
+    }
+    return firstNonTab;
+}
+
+static bool start_with(const std::string& str, const std::string& prefix)
+{
+    return str.rfind(prefix, 0) == 0;
+}
+
+static bool end_with(const std::string& str, const std::string& suffix)
+{
+    return str.rfind(suffix) == (str.length() - suffix.length());
+}
+
+void format_pps_indent(std::string& line, int& indent_level)
+{
+    if (start_with(line, "{"))
+    {
+        indent_level++;
+    }
+    else if (start_with(line, "}"))
+    {
+        indent_level = std::max(0, indent_level - 1);
+    }
+    else
+    {
+        auto currentIndent = count_blank(line);
+        if (currentIndent < indent_level * 4)
+        {
+            line = std::string(indent_level * 4, ' ') + line;
+        }
+    }
+}
+
+void format_pps_enter(std::string& line)
+{
+    if (end_with(line, "}"))
+    {
+        line += "\n";
+    }
+
+    line += "\n";
+}
+
+void limit_conherent_enters(std::string& str, int maxConsecutive)
+{
+    int newlineCount = 0;
+    limit_conherent_enters(str, maxConsecutive, newlineCount);
+}
+
+void limit_conherent_enters(std::string& str, int maxConsecutive, int& newlineCount)
+{
+    if (str.empty() || maxConsecutive < 0)
+        return;
+
+    auto is_win_enter = [&](size_t pos) {
+        return pos + 1 < str.length() && str[pos] == '\r' && str[pos + 1] == '\n';
+    };
+
+    auto is_non_win_enter = [&](size_t pos) {
+        return str[pos] == '\n' || str[pos] == '\r';
+    };
+
+    size_t writePos = 0;
+    for (size_t i = 0; i < str.length(); ++i)
+    {
+        if (is_win_enter(i))
+        {
+            newlineCount++;
+            if (newlineCount <= maxConsecutive)
+            {
+                str[writePos++] = '\n';
+            }
+            ++i;
+        }
+        else if (is_non_win_enter(i))
+        {
+            newlineCount++;
+            if (newlineCount <= maxConsecutive)
+            {
+                str[writePos++] = '\n';
+            }
+        }
+        else
+        {
+            str[writePos++] = str[i];
+            newlineCount    = 0;
+        }
+    }
+
+    str.resize(writePos);
+}
+
+void append_json_string(std::string& out, const std::string& str)
+{
+    out += '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                if (uint8_t(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace pps
@@ -2,7 +2,7 @@
 
 #include <magic_enum/magic_enum.hpp>
 
-#include <aclg/aclg.h>
+#include <diagnostic.h>
 
 #include <iostream>
 #include <cctype>
@@ -25,9 +25,9 @@ void Token::print() const
 Lexer::Lexer(const std::string& input) :
     m_source(input), m_pos(0), m_cur_char(input[m_pos]) {}
 
-std::vector<Token> Lexer::tokenize()
+std::pmr::vector<Token> Lexer::tokenize()
 {
-    std::vector<Token> tokens;
+    std::pmr::vector<Token> tokens(call_resource());
     while (m_cur_char != '\0')
     {
         tokens.push_back(_next());
@@ -185,7 +185,7 @@ Token Lexer::_next()
             }
             case '!':
             {
-                if (_match("!@"))
+                if (_match("!@") || _match("!("))
                 {
                     _advance();
                     return Token(TokenType::tOp_not, "!");
@@ -271,12 +271,10 @@ Token Lexer::_next()
                 }
                 break;
             default:
-            {
-                ACLG_ERROR("Undefined token '{}'(pos {}) in: '{}'", m_cur_char, m_pos, m_source);
-            }
+                break;
         }
 
-        ACLG_ERROR("Undefined token '{}'(pos {}) in: '{}'", m_cur_char, m_pos, m_source);
+        PPS_ERROR(DiagnosticCode::tUndefinedToken, "Undefined token '{}'(pos {}) in: '{}'", m_cur_char, m_pos, m_source);
         return Token(TokenType::tError, std::string(1, m_cur_char));
     }
 
@@ -316,7 +314,7 @@ Token Lexer::_literal_int()
         {
             if (hasDecimal)
             {
-                ACLG_ERROR("Invalid number: multiple decimal points");
+                PPS_ERROR(DiagnosticCode::tInvalidNumber, "Invalid number: multiple decimal points");
                 throw std::runtime_error("Invalid number: multiple decimal points");
             }
             hasDecimal = true;
@@ -339,7 +337,7 @@ Token Lexer::_literal_string()
     }
     if (m_cur_char != '"')
     {
-        ACLG_ERROR("Unterminated string literal");
+        PPS_ERROR(DiagnosticCode::tUnterminatedString, "Unterminated string literal");
         throw std::runtime_error("Unterminated string literal");
     }
 
@@ -74,7 +74,7 @@ void StmtExpressionNode::print(int depth) const
     value->print(depth + 1);
 }
 
-StmtConditionNode::StmtConditionNode(std::vector<ConditionBlock> branches, std::unique_ptr<Node> else_block) :
+StmtConditionNode::StmtConditionNode(std::pmr::vector<ConditionBlock> branches, std::unique_ptr<Node> else_block) :
     branches(std::move(branches)), else_block(std::move(else_block)) {}
 void StmtConditionNode::print(int depth) const
 {
@@ -92,7 +92,7 @@ void StmtConditionNode::print(int depth) const
     }
 }
 
-StmtCompoundNode::StmtCompoundNode(std::vector<std::unique_ptr<Node>> statements) :
+StmtCompoundNode::StmtCompoundNode(std::pmr::vector<std::unique_ptr<Node>> statements) :
     statements(std::move(statements)) {}
 void StmtCompoundNode::print(int depth) const
 {
@@ -1,6 +1,6 @@
 #include <frontend/parser.h>
 
-#include <aclg/aclg.h>
+#include <diagnostic.h>
 
 #include <iostream>
 #include <stdexcept>
@@ -8,11 +8,11 @@
 namespace pps
 {
 
-Parser::Parser(const std::vector<Token>& tokens) :
+Parser::Parser(const std::pmr::vector<Token>& tokens) :
     m_tokens(tokens), m_pos(0) {}
 std::unique_ptr<Node> Parser::parse()
 {
-    std::vector<std::unique_ptr<Node>> statements;
+    std::pmr::vector<std::unique_ptr<Node>> statements(call_resource());
 
     while (!_match(TokenType::tEOF))
     {
@@ -53,11 +53,11 @@ std::unique_ptr<Node> Parser::_parse_statement()
     }
     else if (_match(TokenType::tEOF))
     {
-        ACLG_ERROR("Empty statement");
+        PPS_ERROR(DiagnosticCode::tSyntax, "Empty statement");
         return nullptr;
     }
 
-    ACLG_ERROR("Unknown statement type");
+    PPS_ERROR(DiagnosticCode::tSyntax, "Unknown statement type");
     return nullptr;
 }
 
@@ -66,9 +66,9 @@ std::unique_ptr<Node> Parser::_op_logic_or()
     auto left = _op_logic_and();
     while (_match(TokenType::tOp_or))
     {
-        Token op    = _consume();
-        auto  right = _op_logic_and();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_logic_and();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -78,9 +78,9 @@ std::unique_ptr<Node> Parser::_op_logic_and()
     auto left = _op_bit_or();
     while (_match(TokenType::tOp_and))
     {
-        Token op    = _consume();
-        auto  right = _op_bit_or();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_bit_or();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -90,9 +90,9 @@ std::unique_ptr<Node> Parser::_op_bit_or()
     auto left = _op_bit_xor();
     while (_match(TokenType::tOp_bitOr))
     {
-        Token op    = _consume();
-        auto  right = _op_bit_xor();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_bit_xor();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -102,9 +102,9 @@ std::unique_ptr<Node> Parser::_op_bit_xor()
     auto left = _op_bit_and();
     while (_match(TokenType::tOp_bitXor))
     {
-        Token op    = _consume();
-        auto  right = _op_bit_and();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_bit_and();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -114,9 +114,9 @@ std::unique_ptr<Node> Parser::_op_bit_and()
     auto left = _op_equality();
     while (_match(TokenType::tOp_bitAnd))
     {
-        Token op    = _consume();
-        auto  right = _op_equality();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_equality();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -126,9 +126,9 @@ std::unique_ptr<Node> Parser::_op_equality()
     auto left = _op_relation();
     while (_matchOneOf({TokenType::tOp_equal, TokenType::tOp_unequal}))
     {
-        Token op    = _consume();
-        auto  right = _op_relation();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_relation();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -138,9 +138,9 @@ std::unique_ptr<Node> Parser::_op_relation()
     auto left = _op_shift();
     while (_matchOneOf({TokenType::tOp_less, TokenType::tOp_greater}))
     {
-        Token op    = _consume();
-        auto  right = _op_shift();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_shift();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -150,9 +150,9 @@ std::unique_ptr<Node> Parser::_op_shift()
     auto left = _op_additive();
     while (_matchOneOf({TokenType::tOp_bitLMove, TokenType::tOp_bitRMove}))
     {
-        Token op    = _consume();
-        auto  right = _op_additive();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_additive();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -162,9 +162,9 @@ std::unique_ptr<Node> Parser::_op_additive()
     auto left = _op_multiplicative();
     while (_matchOneOf({TokenType::tOp_add, TokenType::tOp_sub}))
     {
-        Token op    = _consume();
-        auto  right = _op_multiplicative();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_multiplicative();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -174,9 +174,9 @@ std::unique_ptr<Node> Parser::_op_multiplicative()
     auto left = _op_unary();
     while (_matchOneOf({TokenType::tOp_mul, TokenType::tOp_div, TokenType::tOp_mod}))
     {
-        Token op    = _consume();
-        auto  right = _op_unary();
-        left        = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        const auto& op    = _consume();
+        auto        right = _op_unary();
+        left              = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -185,8 +185,8 @@ std::unique_ptr<Node> Parser::_op_unary()
 {
     if (_matchOneOf({TokenType::tOp_not, TokenType::tOp_bitNot}))
     {
-        Token op    = _consume();
-        auto  child = _op_unary();
+        const auto& op    = _consume();
+        auto        child = _op_unary();
         return std::make_unique<UnaryOpNode>(op, std::move(child));
     }
 
@@ -197,22 +197,22 @@ std::unique_ptr<Node> Parser::_primary()
 {
     if (_match(TokenType::tVariable))
     {
-        Token token = _consume();
+        const auto& token = _consume();
         return std::make_unique<VariableNode>(token.value);
     }
     else if (_match(TokenType::tLit_int))
     {
-        Token token = _consume();
+        const auto& token = _consume();
         return std::make_unique<LitIntNode>(std::stoi(token.value));
     }
     else if (_match(TokenType::tLit_bool))
     {
-        Token token = _consume();
+        const auto& token = _consume();
         return std::make_unique<LitBoolNode>(token.value == "true");
     }
     else if (_match(TokenType::tLit_string))
     {
-        Token token = _consume();
+        const auto& token = _consume();
         return std::make_unique<LitStringNode>(token.value);
     }
     else if (_match(TokenType::tOp_Lparen))
@@ -221,22 +221,22 @@ std::unique_ptr<Node> Parser::_primary()
         auto node = _op_logic_or();
         if (!_match(TokenType::tOp_Rparen))
         {
-            ACLG_ERROR("Expected ')'");
+            PPS_ERROR(DiagnosticCode::tSyntax, "Expected ')'");
         }
         _consume();
         return node;
     }
     else
     {
-        ACLG_ERROR("Unexpected token in primary");
+        PPS_ERROR(DiagnosticCode::tSyntax, "Unexpected token in primary");
         return nullptr;
     }
 }
 
 std::unique_ptr<Node> Parser::_stmt_declaration()
 {
-    Token typeToken = _consume();
-    Token nameToken = _consume();
+    const auto& typeToken = _consume();
+    const auto& nameToken = _consume();
     _consume();
     auto value = _op_logic_or();
     return std::make_unique<StmtDeclarationNode>(typeToken, nameToken.value, std::move(value));
@@ -244,7 +244,7 @@ std::unique_ptr<Node> Parser::_stmt_declaration()
 
 std::unique_ptr<Node> Parser::_stmt_assignment()
 {
-    Token nameToken = _consume();
+    const auto& nameToken = _consume();
     if (nameToken.type != TokenType::tVariable)
         throw std::runtime_error("Expected identifier in assignment");
 
@@ -263,7 +263,7 @@ std::unique_ptr<Node> Parser::_stmt_expression()
 
 std::unique_ptr<Node> Parser::_stmt_condition()
 {
-    std::vector<StmtConditionNode::ConditionBlock> branches;
+    std::pmr::vector<StmtConditionNode::ConditionBlock> branches(call_resource());
 
     do
     {
@@ -287,28 +287,31 @@ std::unique_ptr<Node> Parser::_stmt_condition()
         _consume();
 
     if (!_match(TokenType::tCondition_endif))
-        ACLG_ERROR("Expected 'endif'");
+        PPS_ERROR(DiagnosticCode::tSyntax, "Expected 'endif'");
     _consume();
 
     return std::make_unique<StmtConditionNode>(std::move(branches), std::move(else_block));
 }
 
-Token Parser::_peek(int n) const
+// Tokens are handed out by reference, copying one on every look ahead would allocate its value
+static const Token g_eof(TokenType::tEOF, "");
+
+const Token& Parser::_peek(int n) const
 {
     if (m_pos + n < m_tokens.size())
     {
         return m_tokens[m_pos + n];
     }
-    return Token(TokenType::tEOF, "");
+    return g_eof;
 }
 
-Token Parser::_consume()
+const Token& Parser::_consume()
 {
     if (m_pos < m_tokens.size())
     {
         return m_tokens[m_pos++];
     }
-    return Token(TokenType::tEOF, "");
+    return g_eof;
 }
 
 bool Parser::_match(TokenType type)
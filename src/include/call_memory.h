@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace pps
+{
+
+// Resource of the PPS call running on this thread, if any
+inline thread_local std::pmr::memory_resource* t_memory_resource = nullptr;
+
+// Resource for the scratch objects and containers of the call on this thread, the heap outside one
+inline std::pmr::memory_resource* call_resource()
+{
+    return t_memory_resource ? t_memory_resource : std::pmr::new_delete_resource();
+}
+
+// Allocates the call's scratch objects from `resource` for the lifetime of the scope
+class MemoryScope
+{
+    std::pmr::memory_resource* m_outer;
+
+public:
+    explicit MemoryScope(std::pmr::memory_resource* resource) :
+        m_outer(t_memory_resource)
+    {
+        t_memory_resource = resource;
+    }
+
+    ~MemoryScope() { t_memory_resource = m_outer; }
+
+    MemoryScope(const MemoryScope&)            = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+};
+
+// Base of the objects that live within one call (AST nodes, evaluated values). They are
+// allocated from the thread's resource, or the heap without one, and remember which so
+// that they can be freed after the scope ended. The containers of a call (token vectors,
+// child vectors, the evaluator's variables) are std::pmr types built on call_resource().
+// Names and literals stay std::string: they are looked up in and stored into the std::string
+// maps of Context, which would otherwise need a heap copy of each for every lookup.
+struct CallAllocated
+{
+    static void* operator new(std::size_t size)
+    {
+        auto resource = call_resource();
+        auto block    = static_cast<std::byte*>(resource->allocate(size + s_header, alignof(std::max_align_t)));
+        *reinterpret_cast<std::pmr::memory_resource**>(block) = resource;
+        return block + s_header;
+    }
+
+    static void operator delete(void* ptr, std::size_t size)
+    {
+        auto block    = static_cast<std::byte*>(ptr) - s_header;
+        auto resource = *reinterpret_cast<std::pmr::memory_resource**>(block);
+        resource->deallocate(block, size + s_header, alignof(std::max_align_t));
+    }
+
+private:
+    static constexpr std::size_t s_header = alignof(std::max_align_t);
+};
+
+} // namespace pps
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <pps/cancel.h>
+
+namespace pps
+{
+
+// Token of the PPS call running on this thread, if any
+inline thread_local const CancellationToken* t_cancellation = nullptr;
+
+// Attaches `token` to the calls of the thread for the lifetime of the scope
+class CancellationScope
+{
+    const CancellationToken* m_outer;
+
+public:
+    explicit CancellationScope(const CancellationToken* token) :
+        m_outer(t_cancellation)
+    {
+        t_cancellation = token;
+    }
+
+    ~CancellationScope() { t_cancellation = m_outer; }
+
+    CancellationScope(const CancellationScope&)            = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+};
+
+// Throw Cancelled if the call of this thread was cancelled or timed out
+inline void check_cancellation()
+{
+    if (!t_cancellation)
+        return;
+
+    auto status = t_cancellation->status();
+    if (status != CancelStatus::tRunning)
+        throw Cancelled(status);
+}
+
+} // namespace pps
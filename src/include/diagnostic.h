@@ -0,0 +1,151 @@
+#pragma once
+
+#include <pps/diagnostics.h>
+
+#include <aclg/aclg.h>
+
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+namespace pps
+{
+
+// Where the directive being processed on this thread is
+struct DiagnosticLocation
+{
+    std::string file;
+    uint32_t    line = 0;
+};
+
+// Sink of the PPS call running on this thread; nullptr logs through aclg
+struct DiagnosticTarget
+{
+    DiagnosticSink*           sink     = nullptr;
+    const DiagnosticLocation* location = nullptr;
+};
+
+inline thread_local DiagnosticTarget t_diagnostic_target;
+
+// Routes the diagnostics of the thread to `sink` for the lifetime of the scope
+class DiagnosticScope
+{
+    DiagnosticTarget m_outer;
+
+public:
+    explicit DiagnosticScope(DiagnosticSink* sink) :
+        m_outer(t_diagnostic_target)
+    {
+        t_diagnostic_target = {sink, nullptr};
+    }
+
+    ~DiagnosticScope() { t_diagnostic_target = m_outer; }
+
+    DiagnosticScope(const DiagnosticScope&)            = delete;
+    DiagnosticScope& operator=(const DiagnosticScope&) = delete;
+};
+
+// Holds the diagnostics of work that may be discarded. Everything is accepted, so the
+// messages are formatted up front; forward() offers them to the real sink in order, or
+// logs them through aclg without one.
+class DiagnosticBuffer : public DiagnosticSink
+{
+    std::vector<Diagnostic> m_diagnostics;
+
+public:
+    bool accept(const Diagnostic& /*diagnostic*/) override { return true; }
+    void report(Diagnostic diagnostic) override { m_diagnostics.push_back(std::move(diagnostic)); }
+
+    void forward(DiagnosticSink* sink)
+    {
+        for (auto& diagnostic : m_diagnostics)
+        {
+            if (!sink)
+            {
+                if (diagnostic.severity == Severity::tWarning)
+                    ACLG_WARN("{}", diagnostic.message);
+                else
+                    ACLG_ERROR("{}", diagnostic.message);
+                continue;
+            }
+
+            auto message = std::move(diagnostic.message);
+            diagnostic.message.clear();
+            if (!sink->accept(diagnostic))
+                continue;
+
+            diagnostic.message = std::move(message);
+            sink->report(std::move(diagnostic));
+        }
+        m_diagnostics.clear();
+    }
+};
+
+inline void format_diagnostic_into(std::ostringstream& out, std::string_view format)
+{
+    out << format;
+}
+
+template <class T, class... Args>
+void format_diagnostic_into(std::ostringstream& out, std::string_view format, const T& value, const Args&... args)
+{
+    auto pos = format.find("{}");
+    if (pos == std::string_view::npos)
+    {
+        out << format;
+        return;
+    }
+
+    out << format.substr(0, pos) << value;
+    format_diagnostic_into(out, format.substr(pos + 2), args...);
+}
+
+// Same placeholders as the aclg macros
+template <class... Args>
+std::string format_diagnostic(std::string_view format, const Args&... args)
+{
+    std::ostringstream out;
+    format_diagnostic_into(out, format, args...);
+    return out.str();
+}
+
+// The message is only formatted when the sink accepts the diagnostic
+template <class Format>
+void report_diagnostic(DiagnosticSink& sink, DiagnosticCode code, Severity severity, Format&& format)
+{
+    Diagnostic diagnostic;
+    diagnostic.code     = code;
+    diagnostic.severity = severity;
+    if (auto location = t_diagnostic_target.location)
+    {
+        diagnostic.file = location->file;
+        diagnostic.line = location->line;
+    }
+
+    if (!sink.accept(diagnostic))
+        return;
+
+    diagnostic.message = format();
+    sink.report(std::move(diagnostic));
+}
+
+} // namespace pps
+
+// PPS_WARN(code, format, args...) and PPS_ERROR(code, format, args...) report to the
+// call's sink, or log through aclg without one. Building with PPS_NO_DIAGNOSTICS
+// compiles them out, arguments included.
+#ifdef PPS_NO_DIAGNOSTICS
+#    define PPS_DIAGNOSE(severity, log, code, ...) ((void)0)
+#else
+#    define PPS_DIAGNOSE(severity, log, code, ...)                                                                                   \
+        do                                                                                                                           \
+        {                                                                                                                            \
+            if (auto diagnostic_sink = ::pps::t_diagnostic_target.sink)                                                              \
+                ::pps::report_diagnostic(*diagnostic_sink, code, severity, [&]() { return ::pps::format_diagnostic(__VA_ARGS__); }); \
+            else                                                                                                                     \
+                log(__VA_ARGS__);                                                                                                    \
+        } while (0)
+#endif
+
+#define PPS_WARN(code, ...)  PPS_DIAGNOSE(::pps::Severity::tWarning, ACLG_WARN, code, __VA_ARGS__)
+#define PPS_ERROR(code, ...) PPS_DIAGNOSE(::pps::Severity::tError, ACLG_ERROR, code, __VA_ARGS__)
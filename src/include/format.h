@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+namespace pps
+{
+
+void format_pps_indent(std::string& line, int& indent_level);
+
+void format_pps_enter(std::string& line);
+
+void limit_conherent_enters(std::string& str, int maxConsecutive = 2);
+
+// Continue limiting from the enters counted at the end of the previous piece
+void limit_conherent_enters(std::string& str, int maxConsecutive, int& newlineCount);
+
+// Append `str` quoted, with the characters JSON does not allow escaped
+void append_json_string(std::string& out, const std::string& str);
+
+} // namespace pps
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <call_memory.h>
+
 #include <string>
 #include <vector>
 
@@ -94,7 +96,8 @@ class Lexer
 public:
     explicit Lexer(const std::string& input);
 
-    std::vector<Token> tokenize();
+    // Allocated from the call's resource
+    std::pmr::vector<Token> tokenize();
 
 private:
     Token _next();
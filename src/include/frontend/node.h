@@ -1,6 +1,7 @@
 #pragma once
 
 #include <frontend/lexer.h>
+#include <call_memory.h>
 
 #include <memory>
 
@@ -25,7 +26,7 @@ enum class NodeType
     tStmt_compound,
 };
 
-class Node
+class Node : public CallAllocated
 {
 public:
     virtual ~Node()                             = default;
@@ -137,10 +138,10 @@ public:
         std::unique_ptr<Node> condition;
         std::unique_ptr<Node> block;
     };
-    std::vector<ConditionBlock> branches;
-    std::unique_ptr<Node>       else_block;
+    std::pmr::vector<ConditionBlock> branches;
+    std::unique_ptr<Node>            else_block;
 
-    explicit StmtConditionNode(std::vector<ConditionBlock> branches, std::unique_ptr<Node> else_block);
+    explicit StmtConditionNode(std::pmr::vector<ConditionBlock> branches, std::unique_ptr<Node> else_block);
     void     print(int depth = 0) const override;
     NodeType type() const override { return NodeType::tStmt_condition; }
 };
@@ -148,9 +149,9 @@ public:
 class StmtCompoundNode : public Node
 {
 public:
-    std::vector<std::unique_ptr<Node>> statements;
+    std::pmr::vector<std::unique_ptr<Node>> statements;
 
-    explicit StmtCompoundNode(std::vector<std::unique_ptr<Node>> statements);
+    explicit StmtCompoundNode(std::pmr::vector<std::unique_ptr<Node>> statements);
     void     print(int depth = 0) const override;
     NodeType type() const override { return NodeType::tStmt_compound; }
 };
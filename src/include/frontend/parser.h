@@ -10,12 +10,12 @@ namespace pps
 class Node;
 class Parser
 {
-    const std::vector<Token>& m_tokens;
+    const std::pmr::vector<Token>& m_tokens;
 
     size_t m_pos;
 
 public:
-    explicit Parser(const std::vector<Token>& tokens);
+    explicit Parser(const std::pmr::vector<Token>& tokens);
 
     std::unique_ptr<Node> parse();
 
@@ -38,8 +38,8 @@ private:
     std::unique_ptr<Node> _stmt_assignment();
     std::unique_ptr<Node> _stmt_expression();
 
-    Token _peek(int n = 0) const;
-    Token _consume();
+    const Token& _peek(int n = 0) const;
+    const Token& _consume();
     bool  _match(TokenType type);
     bool  _matchOneOf(std::initializer_list<TokenType> types);
 };
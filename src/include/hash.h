@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace pps
+{
+
+// Stable 64-bit hash, identical across runs and machines
+class Hasher
+{
+    static constexpr uint64_t k_seed  = 0x9e3779b97f4a7c15ull;
+    static constexpr uint64_t k_prime = 0xff51afd7ed558ccdull;
+
+    uint64_t m_state = k_seed;
+
+public:
+    Hasher() = default;
+    explicit Hasher(uint64_t seed) :
+        m_state(seed ^ k_seed) {}
+
+    Hasher& update(const void* data, size_t size)
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+        while (size >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes, 8);
+            _mix(word);
+            bytes += 8;
+            size -= 8;
+        }
+
+        uint64_t tail = 0;
+        for (size_t i = 0; i < size; i++)
+            tail |= uint64_t(bytes[i]) << (i * 8);
+        _mix(tail ^ (uint64_t(size) << 56));
+        return *this;
+    }
+
+    Hasher& update(uint64_t value)
+    {
+        _mix(value);
+        return *this;
+    }
+
+    // Length-prefixed, so that consecutive strings never alias
+    Hasher& update(std::string_view str)
+    {
+        _mix(str.size());
+        return update(str.data(), str.size());
+    }
+
+    uint64_t digest() const { return finalize(m_state); }
+
+    static uint64_t finalize(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= k_prime;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    static std::string to_hex(uint64_t value)
+    {
+        static const char digits[] = "0123456789abcdef";
+
+        std::string hex(16, '0');
+        for (int i = 15; i >= 0; i--, value >>= 4)
+            hex[i] = digits[value & 0xf];
+        return hex;
+    }
+
+private:
+    void _mix(uint64_t word)
+    {
+        m_state ^= finalize(word + k_seed);
+        m_state = (m_state << 27 | m_state >> 37) * k_prime + 0x52dce729ull;
+    }
+};
+
+} // namespace pps
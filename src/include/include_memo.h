@@ -0,0 +1,60 @@
+#pragma once
+
+#include <task.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace pps
+{
+
+// What processing one include body read and changed
+struct IncludeEffects
+{
+    std::vector<std::string>                  reads;
+    std::vector<std::string>                  dependencies;
+    std::vector<std::string>                  misses;
+    std::vector<std::pair<std::string, bool>> once_checks;
+    std::vector<std::string>                  once_added;
+
+    // Cut short by an include cycle, which depends on the includes around it
+    bool cycle = false;
+};
+
+// Processed body of an include, valid wherever the same branch stack, variable values
+// and include-once answers lead to it
+struct IncludeMemoEntry
+{
+    std::vector<std::string> reads;
+    uint64_t                 decisions = 0;
+    BranchStack              entry_stack;
+    IncludeEffects           effects;
+
+    std::string output;
+    BranchStack exit_stack;
+    Task::State exit_state = Task::State::sKeep;
+};
+
+// Include bodies processed during one call, shared by the tasks of a batch
+class IncludeMemo
+{
+    // Entries kept per include, beyond which new decision vectors are not stored
+    static constexpr size_t k_max_entries = 16;
+
+    std::mutex m_mutex;
+
+    std::unordered_map<std::string, std::vector<std::shared_ptr<const IncludeMemoEntry>>> m_entries;
+
+public:
+    std::vector<std::shared_ptr<const IncludeMemoEntry>> find(const std::string& path);
+
+    void store(const std::string& path, std::shared_ptr<const IncludeMemoEntry> entry);
+
+    void clear();
+
+    // Hash of what `context` binds `reads` to, with the same variable identity as the output cache
+    static uint64_t decisions(const Context& context, const std::vector<std::string>& reads);
+};
+
+} // namespace pps
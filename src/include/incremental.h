@@ -0,0 +1,124 @@
+#pragma once
+
+#include <task.h>
+
+#include <pps/document.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pps
+{
+
+// Sums of a sequence of sizes (a Fenwick tree): point updates, prefix sums and the
+// search for the element holding an offset all take O(log n)
+class PrefixSums
+{
+    std::vector<size_t> m_tree; // 1-based
+
+public:
+    void assign(const std::vector<size_t>& sizes)
+    {
+        m_tree.assign(sizes.size() + 1, 0);
+        for (size_t i = 1; i < m_tree.size(); i++)
+        {
+            m_tree[i] += sizes[i - 1];
+            auto parent = i + (i & (~i + 1));
+            if (parent < m_tree.size())
+                m_tree[parent] += m_tree[i];
+        }
+    }
+
+    // Wraps around for a shrinking element, which the sums undo
+    void add(size_t index, size_t delta)
+    {
+        for (auto i = index + 1; i < m_tree.size(); i += i & (~i + 1))
+            m_tree[i] += delta;
+    }
+
+    // Sum of the first `count` elements
+    size_t prefix(size_t count) const
+    {
+        size_t sum = 0;
+        for (auto i = count; i > 0; i -= i & (~i + 1))
+            sum += m_tree[i];
+        return sum;
+    }
+
+    // Index of the element holding `offset`, i.e. the largest count whose prefix is not past it
+    size_t find(size_t offset) const
+    {
+        size_t index = 0;
+        size_t step  = 1;
+        while (step * 2 < m_tree.size())
+            step *= 2;
+
+        for (; step > 0; step /= 2)
+        {
+            if (index + step < m_tree.size() && m_tree[index + step] <= offset)
+            {
+                index += step;
+                offset -= m_tree[index];
+            }
+        }
+        return index;
+    }
+};
+
+class IncrementalTask
+{
+    struct Line
+    {
+        size_t      size = 0;
+        std::string output;
+
+        // Context variables read by the line, sorted
+        std::vector<std::string> reads;
+
+        // State after the line; lines without task share the previous one
+        std::shared_ptr<const Task> state;
+        int                         indent_level = 0;
+        int                         enters       = 0;
+    };
+
+    struct Cursor
+    {
+        std::shared_ptr<const Task> state;
+        int                         indent_level = 0;
+        int                         enters       = 0;
+    };
+
+    std::string       m_source;
+    std::string       m_output;
+    std::vector<Line> m_lines;
+
+    // Lengths of the lines with their line break, and of their outputs, so that an edit
+    // finds its place without summing every line before it
+    PrefixSums m_line_offsets;
+    PrefixSums m_output_offsets;
+
+    std::shared_ptr<const Task> m_origin;
+
+public:
+    IncrementalTask(const std::string& source, const Task& origin);
+
+    const std::string& source() const { return m_source; }
+    const std::string& output() const { return m_output; }
+
+    Range edit(size_t offset, size_t length, const std::string& text);
+
+    std::vector<Range> update(const std::string& variable);
+
+private:
+    size_t _line_at(size_t offset) const;
+    size_t _line_begin(size_t index) const;
+    Cursor _cursor_before(size_t index) const;
+    Line   _process_line(Cursor& cursor, size_t begin, size_t size) const;
+    bool   _converged(const Cursor& cursor, const Line& line) const;
+    size_t _output_offset(size_t index) const;
+    void   _rebuild_offsets();
+    Range  _replace(size_t first, size_t last, size_t offset, std::vector<Line> lines);
+};
+
+} // namespace pps
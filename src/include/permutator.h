@@ -0,0 +1,64 @@
+#pragma once
+
+#include <task.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pps
+{
+
+// Output rope; a segment is shared by every permutation that took the same decisions
+// up to its end, and its text by every history that produced it.
+struct Rope
+{
+    std::shared_ptr<const Rope>        prev;
+    std::shared_ptr<const std::string> text;
+};
+
+// Processes one source for many contexts at once. Lines are evaluated once per
+// distinct path through the trie of directive outcomes; the Task state is only
+// cloned where contexts diverge, and paths whose states meet again at the end of
+// a branch are processed as one from there on.
+class Permutator
+{
+    // Contexts that share an output so far
+    struct Lineage
+    {
+        std::shared_ptr<const Rope> rope;
+        std::vector<size_t>         members;
+    };
+
+    // Contexts that process the following lines identically; `text` is their
+    // common output since the group was formed
+    struct Group
+    {
+        Task                 task;
+        int                  indent_level = 0;
+        std::string          text;
+        std::vector<Lineage> lineages;
+    };
+
+    Task                         m_origin;
+    const std::vector<Context*>& m_contexts;
+
+    std::vector<Group>  m_groups;
+    std::vector<size_t> m_outcome_of;
+
+public:
+    Permutator(const Task& origin, const std::vector<Context*>& contexts);
+
+    std::vector<std::string> process(const std::string& source);
+
+private:
+    void _process_origin(Group& group, std::string& line);
+    void _process_task(Group& group, const std::string& line, std::vector<Group>& forks);
+    void _append(Group& group, std::string& line);
+    void _merge(std::vector<Group>& groups);
+
+    static void        _seal(Group& group);
+    static std::string _flatten(const Rope* rope);
+};
+
+} // namespace pps
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <frontend/parser.h>
+#include <call_memory.h>
 
 #include <variant>
 #include <unordered_map>
@@ -15,7 +16,7 @@ enum class ValueType
     tString,
 };
 
-struct Value
+struct Value : CallAllocated
 {
     ValueType                            type;
     std::variant<bool, int, std::string> value;
@@ -99,9 +100,10 @@ class Evaluator
     std::unordered_map<std::string, int>*         m_in_ints;
     std::unordered_map<std::string, std::string>* m_in_strs;
 
-    std::unordered_map<std::string, bool>        m_var_bools;
-    std::unordered_map<std::string, int>         m_var_ints;
-    std::unordered_map<std::string, std::string> m_var_strs;
+    // Declared by the expression itself, allocated from the call's resource
+    std::pmr::unordered_map<std::string, bool>        m_var_bools;
+    std::pmr::unordered_map<std::string, int>         m_var_ints;
+    std::pmr::unordered_map<std::string, std::string> m_var_strs;
 
 public:
     explicit Evaluator(std::unordered_map<std::string, bool>*        b = nullptr,
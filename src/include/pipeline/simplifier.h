@@ -4,9 +4,17 @@
 
 #include <unordered_map>
 #include <memory>
+#include <string>
 
 namespace pps
 {
+enum class Tristate
+{
+    tFalse,
+    tTrue,
+    tUnknown,
+};
+
 class ExprSimplifier
 {
     const std::unordered_map<std::string, std::string>& m_instances;
@@ -24,4 +32,32 @@ private:
     std::unique_ptr<Node> _simplify_unary_op_node(const UnaryOpNode* node);
 };
 
+// Folds the bound variables of an expression into literals and keeps the rest
+class ExprSpecializer
+{
+    const std::unordered_map<std::string, bool>&        m_bools;
+    const std::unordered_map<std::string, int>&         m_ints;
+    const std::unordered_map<std::string, std::string>& m_strs;
+
+public:
+    explicit ExprSpecializer(const std::unordered_map<std::string, bool>&        bools,
+                             const std::unordered_map<std::string, int>&         ints,
+                             const std::unordered_map<std::string, std::string>& strs);
+
+    std::unique_ptr<Node> specialize(const Node* node);
+
+    // Known truth of a specialized condition
+    static Tristate truth(const Node* node);
+
+    // Residual pps source of a specialized expression
+    static std::string to_source(const Node* node);
+
+private:
+    std::unique_ptr<Node> _specialize_node(const Node* node);
+
+    std::unique_ptr<Node> _specialize_variable_node(const VariableNode* node);
+    std::unique_ptr<Node> _specialize_binary_op_node(const BinaryOpNode* node);
+    std::unique_ptr<Node> _specialize_unary_op_node(const UnaryOpNode* node);
+};
+
 } // namespace pps
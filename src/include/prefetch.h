@@ -0,0 +1,57 @@
+#pragma once
+
+#include <task.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace pps
+{
+
+class Executor;
+
+// Reads the includes of a source ahead of the task reaching them. Every include
+// directive found in the source or in a read file is queued on the executor; the
+// task takes the content when it gets there, running the read itself when no
+// worker has started it yet. Reads of includes in skipped branches are wasted.
+// An include provider also gets each scan's new paths as one prefetch batch.
+class IncludePrefetch : public std::enable_shared_from_this<IncludePrefetch>
+{
+    struct Read
+    {
+        std::atomic<bool>               claimed = false;
+        std::promise<IncludeRead>       promise;
+        std::shared_future<IncludeRead> result = promise.get_future().share();
+    };
+
+    Executor&     m_executor;
+    const Context    m_context;
+    IncludeProvider* m_provider;
+    FileCache*       m_files;
+    sbin::Loader*    m_loader;
+    std::string      m_decrypt_key;
+
+    std::mutex                                             m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Read>> m_reads;
+    bool                                                   m_finished = false;
+
+public:
+    IncludePrefetch(Executor& executor, const Context& context, IncludeProvider* provider, FileCache* files, sbin::Loader* module_loader, const std::string& decrypt_key);
+
+    // Queue reads of the includes of `source` not queued yet
+    void scan(const std::string& source);
+
+    // Content of the include `path`, waiting for its read to finish
+    IncludeRead take(const std::string& path);
+
+    // Wait for the running reads and drop the queued ones
+    void finish();
+
+private:
+    void _run(Read& read, const std::string& path);
+};
+
+} // namespace pps
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <pps/stats.h>
+#include <pps/trace.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pps
+{
+
+// Stats and innermost stage that record_allocation() attributes to on this thread
+struct AllocationTarget
+{
+    Stats* stats = nullptr;
+    Stage  stage = Stage::tCount;
+};
+
+inline thread_local AllocationTarget t_allocation_target;
+
+// Adds the lifetime of the scope to a stage; does nothing without stats
+class StageTimer
+{
+    using Clock = std::chrono::steady_clock;
+
+    Stats*            m_stats;
+    Stage             m_stage;
+    Stage             m_outer = Stage::tCount;
+    Clock::time_point m_start;
+
+public:
+    StageTimer(Stats* stats, Stage stage) :
+        m_stats(stats), m_stage(stage)
+    {
+        if (!m_stats)
+            return;
+
+        m_outer                   = t_allocation_target.stage;
+        t_allocation_target.stage = m_stage;
+        m_start                   = Clock::now();
+    }
+
+    ~StageTimer()
+    {
+        if (!m_stats)
+            return;
+
+        auto& stage = m_stats->stages[size_t(m_stage)];
+        stage.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+        stage.count++;
+        t_allocation_target.stage = m_outer;
+    }
+
+    StageTimer(const StageTimer&)            = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+};
+
+// Selects the stats of one PPS call: the session's own, or a local one that is
+// merged into the shared (engine or global) stats when the call returns.
+// Allocations of the call are attributed to it.
+class StatsScope
+{
+    Stats*           m_target = nullptr;
+    Stats*           m_shared = nullptr;
+    Stats            m_local;
+    AllocationTarget m_outer;
+
+public:
+    StatsScope(Stats* own, Stats* shared);
+    ~StatsScope();
+
+    Stats* get() const { return m_target; }
+
+    StatsScope(const StatsScope&)            = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+};
+
+Tracer* global_tracer();
+
+// Emits a begin/end pair around the scope; the name is only built with a tracer
+class TraceScope
+{
+    Tracer*     m_tracer;
+    const char* m_category;
+
+public:
+    TraceScope(Tracer* tracer, const char* category, const char* name) :
+        m_tracer(tracer), m_category(category)
+    {
+        if (m_tracer)
+            m_tracer->begin(m_category, name);
+    }
+
+    TraceScope(Tracer* tracer, const char* category, const std::string& name) :
+        m_tracer(tracer), m_category(category)
+    {
+        if (m_tracer)
+            m_tracer->begin(m_category, name);
+    }
+
+    ~TraceScope()
+    {
+        if (m_tracer)
+            m_tracer->end(m_category);
+    }
+
+    TraceScope(const TraceScope&)            = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+// Holds the events of work that may be discarded, until replay() passes them on in order
+// with the time and thread they were recorded at
+class TraceBuffer : public Tracer
+{
+    struct Event
+    {
+        const char*       category;
+        std::string       name;
+        Clock::time_point time;
+        std::thread::id   thread;
+        bool              begin;
+    };
+
+    std::vector<Event> m_events;
+
+public:
+    void begin(const char* category, const std::string& name) override { begin_at(category, name, Clock::now(), std::this_thread::get_id()); }
+    void end(const char* category) override { end_at(category, Clock::now(), std::this_thread::get_id()); }
+
+    void begin_at(const char* category, const std::string& name, Clock::time_point time, std::thread::id thread) override
+    {
+        m_events.push_back({category, name, time, thread, true});
+    }
+
+    void end_at(const char* category, Clock::time_point time, std::thread::id thread) override
+    {
+        m_events.push_back({category, {}, time, thread, false});
+    }
+
+    void replay(Tracer& tracer) const
+    {
+        for (const auto& event : m_events)
+        {
+            if (event.begin)
+                tracer.begin_at(event.category, event.name, event.time, event.thread);
+            else
+                tracer.end_at(event.category, event.time, event.thread);
+        }
+    }
+};
+
+} // namespace pps
@@ -3,9 +3,17 @@
 #include <frontend/lexer.h>
 #include <frontend/parser.h>
 #include <pipeline/evaluator.h>
+#include <pipeline/simplifier.h>
 
 #include <pps/pps.h>
+#include <pps/stats.h>
+#include <pps/trace.h>
+#include <diagnostic.h>
+#include <cancellation.h>
+#include <call_memory.h>
 
+#include <memory>
+#include <set>
 #include <stack>
 
 namespace pps
@@ -24,6 +32,8 @@ struct StaticBranch
     BranchTag type       = BranchTag::tIf;
     bool      choosed_if = false;
     bool      current    = false;
+
+    bool operator==(const StaticBranch&) const = default;
 };
 
 struct DynamicBranch
@@ -32,11 +42,43 @@ struct DynamicBranch
     bool        enable_else = false;
     bool        current     = false;
     std::string condition_expr;
+
+    bool operator==(const DynamicBranch&) const = default;
+};
+
+// Branch of a partially bound context: the body is kept when known true or
+// unknown, and residual directives are emitted for the unknown arms.
+struct PartialBranch
+{
+    BranchTag type       = BranchTag::tIf;
+    bool      choosed_if = false;
+    bool      residual   = false;
+    bool      current    = false;
+
+    bool operator==(const PartialBranch&) const = default;
+};
+
+using BranchStack = std::stack<std::variant<StaticBranch, DynamicBranch, PartialBranch>>;
+
+class FileCache;
+class IncludeProvider;
+class IncludePrefetch;
+class IncludeMemo;
+struct IncludeEffects;
+
+// Content of an include and the resolved paths it was read from; the content is
+// shared with the file cache or provider where possible, nullptr if nothing was found.
+// `misses` are the candidates probed before the hit, or all of them when nothing was found.
+struct IncludeRead
+{
+    std::shared_ptr<const std::string> content;
+    std::vector<std::string>           dependencies;
+    std::vector<std::string>           misses;
 };
 
 class Task
 {
-    Context* m_context;
+    Context* m_context = nullptr;
 
     sbin::Loader* m_loader      = nullptr;
     std::string   m_decrypt_key = "";
@@ -51,6 +93,7 @@ public:
         tOverride,
         tEmbed,
         tProg,
+        tOnce,
     };
 
     enum class State
@@ -64,15 +107,125 @@ public:
     void set_ctx(Context* context);
     void set_ctx(Context* context, sbin::Loader* module_loader, const std::string& decrypt_key);
 
+    // Keep directives depending on unbound variables instead of resolving them
+    void set_partial(bool partial);
+
+    // Collect the context variables read by the following lines
+    void set_reads(std::vector<std::string>* reads);
+
+    // Collect the resolved paths of the included files
+    void set_dependencies(std::vector<std::string>* dependencies);
+
+    // Collect the include candidates that were probed and did not exist
+    void set_misses(std::vector<std::string>* misses);
+
+    std::vector<std::string>* misses() const { return m_misses; }
+
+    // Read includes through a cache shared with other tasks
+    void set_file_cache(FileCache* files);
+
+    // Read includes from `provider` alone instead of the prefixes and the loader; nullptr
+    // restores those
+    void set_include_provider(IncludeProvider* provider);
+
+    // Expand every include at most once per call, as if each had a pragma once
+    void set_include_once(bool once);
+
+    // Reuse processed include bodies from `memo`; nullptr processes every include
+    void set_include_memo(IncludeMemo* memo);
+
+    // Take includes from reads issued ahead; nullptr reads them when reached
+    void set_prefetch(IncludePrefetch* prefetch);
+
+    // Expand the next include from `read`, made by a task with the same prefixes, instead
+    // of reading it again; nullptr reads as usual
+    void set_include_read(const IncludeRead* read);
+
+    // Read an include the way the next include directive would
+    IncludeRead read_include(const std::string& path) const;
+
+    // Accumulate stage timings and counters; nullptr disables measuring
+    void set_stats(Stats* stats);
+
+    Stats* stats() const { return m_stats; }
+
+    std::vector<std::string>* reads() const { return m_reads; }
+
+    // Resolved paths of the includes that are not expanded again in this call
+    const std::set<std::string>& once() const { return m_once; }
+
+    // Report directive and include slices; nullptr disables tracing
+    void set_tracer(Tracer* tracer);
+
+    Tracer* tracer() const { return m_tracer; }
+
+    // Clear the branch stack and prog source left by an earlier call
+    void reset();
+
+    // Number the following lines from `line` + 1, for diagnostics
+    void set_line(uint32_t line);
+
     State process(std::string& line);
 
+    // Process a line known to hold no directive, without scanning it
+    State process_origin(std::string& line);
+
+    State state() const { return m_state; }
+
+    // Whether two tasks would process the following lines identically
+    bool same_state(const Task& other) const;
+
+    // Whether no branch or prog block is open
+    bool at_top_level() const;
+
+    size_t branch_depth() const { return m_branch_stack.size(); }
+
+    static bool has_task(const std::string& line);
+
+    // +1 for a line opening a branch, -1 for one closing it, 0 otherwise; decided by
+    // the directive alone, as the branch stack sees it
+    static int branch_delta(const std::string& line);
+
+    // Path of the include directive on `line`, if it holds one
+    static bool extract_include(const std::string& line, std::string& path);
+
+    // Read an include from `provider`, or else from the context's prefixes and the loader;
+    // touches no task state
+    static IncludeRead read_include(const std::string& path, const Context& context, IncludeProvider* provider, FileCache* files, sbin::Loader* module_loader, const std::string& decrypt_key, Stats* stats);
+
 private:
     State m_state = State::sKeep;
     Type  m_type  = Type::tOrigin;
 
+    bool m_partial = false;
+
+    std::vector<std::string>* m_reads        = nullptr;
+    std::vector<std::string>* m_dependencies = nullptr;
+    std::vector<std::string>* m_misses       = nullptr;
+
+    FileCache*       m_files    = nullptr;
+    IncludeProvider* m_provider = nullptr;
+    IncludePrefetch* m_prefetch = nullptr;
+    IncludeMemo*     m_memo     = nullptr;
+    Stats*           m_stats    = nullptr;
+    Tracer*          m_tracer   = nullptr;
+
+    const IncludeRead* m_include_read = nullptr;
+
+    DiagnosticLocation m_location;
+
+    Directive m_directive = Directive::tStatic;
+
     // Branch
 private:
-    std::stack<std::variant<StaticBranch, DynamicBranch>> m_branch_stack;
+    BranchStack m_branch_stack;
+
+    // Include
+private:
+    bool                     m_include_once = false;
+    std::set<std::string>    m_once;
+    std::vector<std::string> m_include_stack;
+    IncludeEffects*          m_effects = nullptr;
 
     // Prog
 private:
@@ -90,6 +243,12 @@ private:
     bool          _in_miss_branch();
     StaticBranch  _pop_static();
     DynamicBranch _pop_dynamic();
+    PartialBranch _pop_partial();
+    void          _record_read(const std::string& name);
+    void          _record_reads(const std::pmr::vector<Token>& tokens);
+    void          _record_dependency(const std::string& path);
+    void          _record_miss(const std::string& path);
+    void          _record_directive(Directive directive);
 
     // Origin
     void _process_origin(std::string& line);
@@ -100,26 +259,37 @@ private:
     DynamicBranch _eval_dynamic_banch(std::string& line);
     void          _process_static_branch(std::string& line);
     std::string   _process_dynamic_branch(std::string& line);
-    bool          _has_branch_true(const std::vector<Token>& tokens);
+    bool          _has_branch_true(const std::pmr::vector<Token>& tokens);
     bool          _is_valid_condition_expr(const Node* node);
     bool          _eval_condition_expr(const std::string& line);
     std::string   _gen_condition_expr(const Node* node);
 
+    // Expression
+    std::unique_ptr<Node> _parse_expr(const std::string& line);
+    std::unique_ptr<Node> _simplify_dynamic_expr(const std::string& line);
+
+    // Partial
+    void     _process_partial_branch(const std::string& origin, std::string& line);
+    Tristate _eval_partial_condition_expr(std::string& line);
+
     // Include
-    void        _process_include(std::string& line);
-    std::string _extract_include_from_ctx(const std::string& path);
-    std::string _extract_include_from_loader(const std::string& path);
+    void _process_include(std::string& line);
+    bool _check_once(const std::string& key);
+    void _add_once(const std::string& key);
+    bool _replay_include(const std::string& key, std::string& out);
+    void _memoize_include(const std::string& key, BranchStack entry_stack, IncludeEffects effects, const std::string& out);
+    void _process_once(std::string& line);
 
     // Override
     void _process_override(std::string& origin, std::string& line);
     void _extract_override_task(std::string& line);
 
     // Embed
-    void _process_embed(std::string& line);
+    void _process_embed(std::string& origin, std::string& line);
     void _extract_embed_task(std::string& line);
 
     // Prog
-    void     _process_prog(std::string& line);
+    void     _process_prog(std::string& origin, std::string& line);
     void     _eval_prog(std::string& line);
     ProgType _extract_prog_task(std::string& line);
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace pps
+{
+
+// LEB128 varints and varint-prefixed blobs of the serialized contexts, the binary
+// manifest and the server protocol
+
+inline void write_varint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += char(value | 0x80);
+        value >>= 7;
+    }
+    out += char(value);
+}
+
+inline void write_blob(std::string& out, std::string_view blob)
+{
+    write_varint(out, blob.size());
+    out += blob;
+}
+
+inline bool read_varint(std::string_view& in, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (in.empty())
+            return false;
+
+        auto byte = uint8_t(in.front());
+        in.remove_prefix(1);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool read_blob(std::string_view& in, std::string_view& blob)
+{
+    uint64_t size;
+    if (!read_varint(in, size) || size > in.size())
+        return false;
+
+    blob = in.substr(0, size);
+    in.remove_prefix(size);
+    return true;
+}
+
+} // namespace pps
@@ -0,0 +1,61 @@
+#include <include_memo.h>
+#include <hash.h>
+
+namespace pps
+{
+
+std::vector<std::shared_ptr<const IncludeMemoEntry>> IncludeMemo::find(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto iter = m_entries.find(path);
+    if (iter == m_entries.end())
+        return {};
+    return iter->second;
+}
+
+void IncludeMemo::store(const std::string& path, std::shared_ptr<const IncludeMemoEntry> entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto& entries = m_entries[path];
+    if (entries.size() < k_max_entries)
+        entries.push_back(std::move(entry));
+}
+
+void IncludeMemo::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+uint64_t IncludeMemo::decisions(const Context& context, const std::vector<std::string>& reads)
+{
+    Hasher hasher;
+    hasher.update(uint64_t(context.isStatic));
+    for (const auto& prefix : context.prefixes)
+        hasher.update(prefix);
+
+    for (const auto& name : reads)
+    {
+        hasher.update(name);
+
+        auto bool_iter = context.bools.find(name);
+        hasher.update(bool_iter == context.bools.end() ? 2 : uint64_t(bool_iter->second));
+
+        auto int_iter = context.ints.find(name);
+        hasher.update(int_iter == context.ints.end() ? 0 : 1);
+        hasher.update(int_iter == context.ints.end() ? 0 : uint64_t(int_iter->second));
+
+        auto str_iter = context.strings.find(name);
+        hasher.update(str_iter == context.strings.end() ? 0 : 1);
+        hasher.update(str_iter == context.strings.end() ? "" : str_iter->second);
+
+        auto instance_iter = context.instances.find(name);
+        hasher.update(instance_iter == context.instances.end() ? 0 : 1);
+        hasher.update(instance_iter == context.instances.end() ? "" : instance_iter->second);
+    }
+    return hasher.digest();
+}
+
+} // namespace pps
@@ -0,0 +1,180 @@
+#include <pps/include_provider.h>
+#include <pps/file_cache.h>
+
+#include <sbin/loader.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+namespace pps
+{
+
+static const std::string g_memory_prefix = "@memory/";
+static const std::string g_loader_prefix = "@loader/";
+
+static std::shared_ptr<const std::string> read_disk(const std::string& path, FileCache* files)
+{
+    if (files)
+        return files->read(path);
+
+    if (!std::filesystem::exists(path))
+        return nullptr;
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return nullptr;
+
+    stream.seekg(0, std::ios::end);
+    std::streamsize size = stream.tellg();
+    stream.seekg(0, std::ios::beg);
+
+    std::string content(size, '\0');
+    if (!stream.read(&content[0], size))
+        return nullptr;
+    return std::make_shared<const std::string>(std::move(content));
+}
+
+void MemoryProvider::add(const std::string& path, std::string content)
+{
+    add(path, std::make_shared<const std::string>(std::move(content)));
+}
+
+void MemoryProvider::add(const std::string& path, std::shared_ptr<const std::string> content)
+{
+    std::unique_lock lock(m_mutex);
+    m_files[path] = std::move(content);
+}
+
+void MemoryProvider::remove(const std::string& path)
+{
+    std::unique_lock lock(m_mutex);
+    m_files.erase(path);
+}
+
+bool MemoryProvider::read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file)
+{
+    std::shared_lock lock(m_mutex);
+
+    auto find = [&](const std::string& name) {
+        auto iter = m_files.find(name);
+        if (iter == m_files.end())
+            return false;
+
+        file.content = iter->second;
+        file.path    = g_memory_prefix + name;
+        return true;
+    };
+
+    for (const auto& prefix : prefixes)
+    {
+        if (find(prefix + path))
+            return true;
+    }
+    return find(path);
+}
+
+bool MemoryProvider::read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content)
+{
+    if (dependency.rfind(g_memory_prefix, 0) != 0)
+        return false;
+
+    std::shared_lock lock(m_mutex);
+    auto             iter = m_files.find(dependency.substr(g_memory_prefix.size()));
+    if (iter == m_files.end())
+        return false;
+
+    content = iter->second;
+    return true;
+}
+
+bool DiskProvider::read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file)
+{
+    for (const auto& prefix : prefixes)
+    {
+        auto fullPath = prefix + path;
+        if (!(file.content = read_disk(fullPath, m_files)))
+            continue;
+
+        file.path = fullPath;
+        return true;
+    }
+
+    return false;
+}
+
+void DiskProvider::prefetch(const std::vector<std::string>& paths, const std::set<std::string>& prefixes)
+{
+    if (!m_files)
+        return;
+
+    IncludeFile file;
+    for (const auto& path : paths)
+        read(path, prefixes, file);
+}
+
+bool DiskProvider::read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content)
+{
+    if (dependency.rfind('@', 0) == 0)
+        return false;
+
+    content = read_disk(dependency, m_files);
+    return content != nullptr;
+}
+
+bool LoaderProvider::read(const std::string& path, const std::set<std::string>& /*prefixes*/, IncludeFile& file)
+{
+    if (m_loader == nullptr)
+        return false;
+
+    auto data = m_loader->get_shader(path, m_decrypt_key);
+    if (data == nullptr)
+        return false;
+
+    file.content = std::make_shared<const std::string>(data->data.begin(), data->data.end());
+    file.path    = g_loader_prefix + path;
+    return true;
+}
+
+bool LoaderProvider::read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content)
+{
+    IncludeFile file;
+    if (dependency.rfind(g_loader_prefix, 0) != 0 || !read(dependency.substr(g_loader_prefix.size()), {}, file))
+        return false;
+
+    content = std::move(file.content);
+    return true;
+}
+
+void ChainProvider::add(IncludeProvider* provider)
+{
+    m_providers.push_back(provider);
+}
+
+bool ChainProvider::read(const std::string& path, const std::set<std::string>& prefixes, IncludeFile& file)
+{
+    for (auto provider : m_providers)
+    {
+        if (provider->read(path, prefixes, file))
+            return true;
+    }
+    return false;
+}
+
+void ChainProvider::prefetch(const std::vector<std::string>& paths, const std::set<std::string>& prefixes)
+{
+    for (auto provider : m_providers)
+        provider->prefetch(paths, prefixes);
+}
+
+bool ChainProvider::read_dependency(const std::string& dependency, std::shared_ptr<const std::string>& content)
+{
+    for (auto provider : m_providers)
+    {
+        if (provider->read_dependency(dependency, content))
+            return true;
+    }
+    return false;
+}
+
+} // namespace pps
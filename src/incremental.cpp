@@ -0,0 +1,232 @@
+#include <incremental.h>
+#include <format.h>
+
+#include <algorithm>
+
+namespace pps
+{
+
+IncrementalTask::IncrementalTask(const std::string& source, const Task& origin) :
+    m_source(source), m_origin(std::make_shared<Task>(origin))
+{
+    Cursor cursor = _cursor_before(0);
+
+    size_t pos = 0;
+    while (true)
+    {
+        auto enter = m_source.find('\n', pos);
+        if (enter == std::string::npos)
+        {
+            m_lines.push_back(_process_line(cursor, pos, m_source.size() - pos));
+            break;
+        }
+
+        m_lines.push_back(_process_line(cursor, pos, enter - pos));
+        pos = enter + 1;
+    }
+
+    for (const auto& line : m_lines)
+        m_output += line.output;
+    _rebuild_offsets();
+}
+
+Range IncrementalTask::edit(size_t offset, size_t length, const std::string& text)
+{
+    offset = std::min(offset, m_source.size());
+    length = std::min(length, m_source.size() - offset);
+
+    auto first = _line_at(offset);
+    auto last  = _line_at(offset + length);
+
+    auto begin = _line_begin(first);
+    auto end   = _line_begin(last) + m_lines[last].size + text.size() - length;
+    m_source.replace(offset, length, text);
+
+    // Re-split and re-process the lines covered by the edit
+    Cursor            cursor = _cursor_before(first);
+    std::vector<Line> lines;
+
+    size_t pos = begin;
+    while (true)
+    {
+        auto enter = m_source.find('\n', pos);
+        if (enter == std::string::npos || enter >= end)
+        {
+            lines.push_back(_process_line(cursor, pos, end - pos));
+            break;
+        }
+
+        lines.push_back(_process_line(cursor, pos, enter - pos));
+        pos = enter + 1;
+    }
+
+    // Following lines only need processing until the state meets the old one again
+    auto next = last + 1;
+    pos       = end + 1;
+    while (next < m_lines.size() && !_converged(cursor, m_lines[next - 1]))
+    {
+        lines.push_back(_process_line(cursor, pos, m_lines[next].size));
+        pos += m_lines[next].size + 1;
+        next++;
+    }
+
+    return _replace(first, next, _output_offset(first), std::move(lines));
+}
+
+std::vector<Range> IncrementalTask::update(const std::string& variable)
+{
+    std::vector<Range> ranges;
+
+    size_t offset = 0;
+    size_t begin  = 0;
+    size_t index  = 0;
+    while (index < m_lines.size())
+    {
+        const auto& reads = m_lines[index].reads;
+        if (!std::binary_search(reads.begin(), reads.end(), variable))
+        {
+            offset += m_lines[index].output.size();
+            begin += m_lines[index].size + 1;
+            index++;
+            continue;
+        }
+
+        Cursor            cursor = _cursor_before(index);
+        std::vector<Line> lines;
+        lines.push_back(_process_line(cursor, begin, m_lines[index].size));
+        begin += m_lines[index].size + 1;
+
+        auto next = index + 1;
+        while (next < m_lines.size() && !_converged(cursor, m_lines[next - 1]))
+        {
+            lines.push_back(_process_line(cursor, begin, m_lines[next].size));
+            begin += m_lines[next].size + 1;
+            next++;
+        }
+
+        auto range = _replace(index, next, offset, std::move(lines));
+        ranges.push_back(range);
+
+        offset += range.length;
+        index = next;
+    }
+
+    return ranges;
+}
+
+size_t IncrementalTask::_line_at(size_t offset) const
+{
+    return std::min(m_line_offsets.find(offset), m_lines.size() - 1);
+}
+
+size_t IncrementalTask::_line_begin(size_t index) const
+{
+    return m_line_offsets.prefix(index);
+}
+
+IncrementalTask::Cursor IncrementalTask::_cursor_before(size_t index) const
+{
+    if (index == 0)
+        return {m_origin, 0, 0};
+
+    const auto& line = m_lines[index - 1];
+    return {line.state, line.indent_level, line.enters};
+}
+
+IncrementalTask::Line IncrementalTask::_process_line(Cursor& cursor, size_t begin, size_t size) const
+{
+    Line line;
+    line.size = size;
+
+    auto text = m_source.substr(begin, size);
+    if (Task::has_task(text))
+    {
+        auto task = std::make_shared<Task>(*cursor.state);
+        task->set_reads(&line.reads);
+        task->process(text);
+        task->set_reads(nullptr);
+        cursor.state = std::move(task);
+
+        std::sort(line.reads.begin(), line.reads.end());
+        line.reads.erase(std::unique(line.reads.begin(), line.reads.end()), line.reads.end());
+    }
+    else if (cursor.state->state() == Task::State::sSkip)
+    {
+        text.clear();
+    }
+
+    if (!text.empty())
+    {
+        format_pps_indent(text, cursor.indent_level);
+        limit_conherent_enters(text, 2, cursor.enters);
+    }
+
+    line.output       = std::move(text);
+    line.state        = cursor.state;
+    line.indent_level = cursor.indent_level;
+    line.enters       = cursor.enters;
+    return line;
+}
+
+bool IncrementalTask::_converged(const Cursor& cursor, const Line& line) const
+{
+    if (cursor.indent_level != line.indent_level || cursor.enters != line.enters)
+        return false;
+
+    return cursor.state == line.state || cursor.state->same_state(*line.state);
+}
+
+size_t IncrementalTask::_output_offset(size_t index) const
+{
+    return m_output_offsets.prefix(index);
+}
+
+void IncrementalTask::_rebuild_offsets()
+{
+    std::vector<size_t> line_sizes;
+    std::vector<size_t> output_sizes;
+    line_sizes.reserve(m_lines.size());
+    output_sizes.reserve(m_lines.size());
+    for (const auto& line : m_lines)
+    {
+        line_sizes.push_back(line.size + 1);
+        output_sizes.push_back(line.output.size());
+    }
+
+    m_line_offsets.assign(line_sizes);
+    m_output_offsets.assign(output_sizes);
+}
+
+Range IncrementalTask::_replace(size_t first, size_t last, size_t offset, std::vector<Line> lines)
+{
+    size_t removed = 0;
+    for (size_t i = first; i < last; i++)
+        removed += m_lines[i].output.size();
+
+    std::string inserted;
+    for (const auto& line : lines)
+        inserted += line.output;
+
+    m_output.replace(offset, removed, inserted);
+
+    // An edit within lines keeps their number and only updates their sums
+    if (lines.size() == last - first)
+    {
+        for (size_t i = 0; i < lines.size(); i++)
+        {
+            auto& line = m_lines[first + i];
+            m_line_offsets.add(first + i, lines[i].size - line.size);
+            m_output_offsets.add(first + i, lines[i].output.size() - line.output.size());
+            line = std::move(lines[i]);
+        }
+        return {offset, inserted.size()};
+    }
+
+    m_lines.erase(m_lines.begin() + first, m_lines.begin() + last);
+    m_lines.insert(m_lines.begin() + first, std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.end()));
+    _rebuild_offsets();
+
+    return {offset, inserted.size()};
+}
+
+} // namespace pps
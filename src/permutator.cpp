@@ -0,0 +1,241 @@
+#include <permutator.h>
+#include <format.h>
+#include <stage_timer.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace pps
+{
+
+Permutator::Permutator(const Task& origin, const std::vector<Context*>& contexts) :
+    m_origin(origin), m_contexts(contexts) {}
+
+std::vector<std::string> Permutator::process(const std::string& source)
+{
+    std::vector<std::string> outputs(m_contexts.size());
+    if (m_contexts.empty())
+        return outputs;
+
+    Group root;
+    root.task = m_origin;
+    root.task.set_ctx(m_contexts[0]);
+    root.lineages.emplace_back();
+    for (size_t i = 0; i < m_contexts.size(); i++)
+        root.lineages[0].members.push_back(i);
+    m_groups.push_back(std::move(root));
+    m_outcome_of.assign(m_contexts.size(), 0);
+
+    std::istringstream iss(source);
+    std::string        line;
+    while (std::getline(iss, line))
+    {
+        bool directive;
+        {
+            StageTimer timer(m_origin.stats(), Stage::tScan);
+            directive = Task::has_task(line);
+        }
+        if (!directive)
+        {
+            for (auto& group : m_groups)
+            {
+                auto copy = line;
+                _process_origin(group, copy);
+            }
+            continue;
+        }
+
+        // Paths can only meet again where a branch closes
+        auto depth = m_groups.front().task.branch_depth();
+
+        std::vector<Group> forks;
+        for (auto& group : m_groups)
+            _process_task(group, line, forks);
+        if (forks.size() > 1 && forks.front().task.branch_depth() < depth)
+            _merge(forks);
+        m_groups = std::move(forks);
+    }
+
+    for (auto& group : m_groups)
+    {
+        _seal(group);
+        for (auto& lineage : group.lineages)
+        {
+            std::string output;
+            {
+                StageTimer timer(m_origin.stats(), Stage::tOutput);
+                output = _flatten(lineage.rope.get());
+            }
+            {
+                StageTimer timer(m_origin.stats(), Stage::tFormat);
+                limit_conherent_enters(output);
+            }
+            for (auto member : lineage.members)
+                outputs[member] = output;
+        }
+    }
+
+    m_groups.clear();
+    return outputs;
+}
+
+void Permutator::_process_origin(Group& group, std::string& line)
+{
+    group.task.process_origin(line);
+    _append(group, line);
+}
+
+void Permutator::_process_task(Group& group, const std::string& line, std::vector<Group>& forks)
+{
+    struct Outcome
+    {
+        Task        task;
+        std::string line;
+    };
+    std::vector<Outcome> outcomes;
+
+    // Members with the same prefixes resolve an include to the same file
+    struct SharedRead
+    {
+        const std::set<std::string>* prefixes;
+        IncludeRead                  read;
+    };
+    std::vector<SharedRead> reads;
+    std::string             path;
+    bool                    include = group.task.state() == Task::State::sKeep && Task::extract_include(line, path);
+
+    for (const auto& lineage : group.lineages)
+    {
+        for (auto member : lineage.members)
+        {
+            Task task = group.task;
+            task.set_ctx(m_contexts[member]);
+
+            if (include)
+            {
+                const auto& prefixes = m_contexts[member]->prefixes;
+                auto        read     = std::find_if(reads.begin(), reads.end(), [&](const SharedRead& shared) { return *shared.prefixes == prefixes; });
+                if (read == reads.end())
+                {
+                    StageTimer timer(m_origin.stats(), Stage::tInclude);
+                    reads.push_back({&prefixes, task.read_include(path)});
+                    read = reads.end() - 1;
+                }
+                task.set_include_read(&read->read);
+            }
+
+            auto result = line;
+            task.process(result);
+            task.set_include_read(nullptr);
+
+            auto iter = outcomes.begin();
+            for (; iter != outcomes.end(); ++iter)
+            {
+                if (iter->line == result && iter->task.same_state(task))
+                    break;
+            }
+
+            m_outcome_of[member] = iter - outcomes.begin();
+            if (iter == outcomes.end())
+                outcomes.push_back({std::move(task), std::move(result)});
+        }
+    }
+
+    if (outcomes.size() == 1)
+    {
+        group.task = std::move(outcomes[0].task);
+        _append(group, outcomes[0].line);
+        forks.push_back(std::move(group));
+        return;
+    }
+
+    // Each fork continues the lineages of its members from the common output so far
+    _seal(group);
+    auto first = forks.size();
+    for (auto& outcome : outcomes)
+    {
+        Group fork;
+        fork.task         = std::move(outcome.task);
+        fork.indent_level = group.indent_level;
+        forks.push_back(std::move(fork));
+    }
+    for (auto& lineage : group.lineages)
+    {
+        for (auto member : lineage.members)
+        {
+            auto& lineages = forks[first + m_outcome_of[member]].lineages;
+            if (lineages.empty() || lineages.back().rope != lineage.rope)
+                lineages.push_back({lineage.rope, {}});
+            lineages.back().members.push_back(member);
+        }
+    }
+    for (size_t i = 0; i < outcomes.size(); i++)
+        _append(forks[first + i], outcomes[i].line);
+}
+
+void Permutator::_append(Group& group, std::string& line)
+{
+    if (line.empty())
+        return;
+
+    {
+        StageTimer timer(m_origin.stats(), Stage::tFormat);
+        format_pps_indent(line, group.indent_level);
+    }
+
+    StageTimer timer(m_origin.stats(), Stage::tOutput);
+    group.text += line;
+}
+
+void Permutator::_merge(std::vector<Group>& groups)
+{
+    std::vector<Group> merged;
+    for (auto& group : groups)
+    {
+        auto iter = std::find_if(merged.begin(), merged.end(), [&](const Group& other) {
+            return other.indent_level == group.indent_level && other.task.same_state(group.task);
+        });
+        if (iter == merged.end())
+        {
+            merged.push_back(std::move(group));
+            continue;
+        }
+
+        _seal(*iter);
+        _seal(group);
+        for (auto& lineage : group.lineages)
+            iter->lineages.push_back(std::move(lineage));
+    }
+    groups = std::move(merged);
+}
+
+void Permutator::_seal(Group& group)
+{
+    if (group.text.empty())
+        return;
+
+    auto text = std::make_shared<const std::string>(std::move(group.text));
+    group.text.clear();
+    for (auto& lineage : group.lineages)
+        lineage.rope = std::make_shared<const Rope>(Rope{lineage.rope, text});
+}
+
+std::string Permutator::_flatten(const Rope* rope)
+{
+    std::vector<const Rope*> chain;
+    size_t                   size = 0;
+    for (; rope != nullptr; rope = rope->prev.get())
+    {
+        chain.push_back(rope);
+        size += rope->text->size();
+    }
+
+    std::string output;
+    output.reserve(size);
+    for (auto iter = chain.rbegin(); iter != chain.rend(); ++iter)
+        output += *(*iter)->text;
+
+    return output;
+}
+
+} // namespace pps
@@ -4,7 +4,8 @@
 
 #include <magic_enum/magic_enum.hpp>
 
-#include <aclg/aclg.h>
+#include <diagnostic.h>
+#include <cancellation.h>
 
 #include <stdexcept>
 #include <iostream>
@@ -137,6 +138,8 @@ StringValue StringValue::operator*(const IntValue& other) const
     std::string result;
     for (int i = 0; i < repeat; ++i)
     {
+        if (i % 4096 == 4095)
+            check_cancellation();
         result += std::get<std::string>(value);
     }
     return StringValue(result);
@@ -155,7 +158,7 @@ BoolValue StringValue::operator!=(const StringValue& other) const
 }
 
 Evaluator::Evaluator(std::unordered_map<std::string, bool>* b, std::unordered_map<std::string, int>* i, std::unordered_map<std::string, std::string>* s) :
-    m_in_bools(b), m_in_ints(i), m_in_strs(s) {}
+    m_in_bools(b), m_in_ints(i), m_in_strs(s), m_var_bools(call_resource()), m_var_ints(call_resource()), m_var_strs(call_resource()) {}
 
 std::unique_ptr<Value> Evaluator::evaluate(const Node* node)
 {
@@ -189,7 +192,7 @@ std::unique_ptr<Value> Evaluator::_visit(const Node* node)
         case NodeType::tStmt_compound:
             return _visit_stmt_compound(static_cast<const StmtCompoundNode*>(node));
         default:
-            ACLG_ERROR("Unknown node type");
+            PPS_ERROR(DiagnosticCode::tUnknownNode, "Unknown node type");
             return nullptr;
     }
 }
@@ -283,7 +286,7 @@ std::unique_ptr<Value> Evaluator::_visit_binary_op(const BinaryOpNode* node)
         }
     }
 
-    ACLG_ERROR("Unknown binary operator: {}", node->op.value);
+    PPS_ERROR(DiagnosticCode::tUnknownOperator, "Unknown binary operator: {}", node->op.value);
     return nullptr;
 }
 
@@ -291,9 +294,9 @@ std::unique_ptr<Value> Evaluator::_visit_unary_op(const UnaryOpNode* node)
 {
     auto val = _visit(node->child.get());
     if (node->op.type == TokenType::tOp_not)
-        return std::make_unique<BoolValue>(!val);
+        return std::make_unique<BoolValue>(val->type == ValueType::tBool && !std::get<bool>(val->value));
 
-    ACLG_ERROR("Unknown unary operator: {}", node->op.value);
+    PPS_ERROR(DiagnosticCode::tUnknownOperator, "Unknown unary operator: {}", node->op.value);
     return nullptr;
 }
 
@@ -325,7 +328,7 @@ std::unique_ptr<Value> Evaluator::_visit_variable(const VariableNode* node)
             return std::make_unique<StringValue>(iter->second);
     }
 
-    ACLG_ERROR("Undefined variable: {}, type: {}", node->name, magic_enum::enum_name(node->type()));
+    PPS_ERROR(DiagnosticCode::tUndefinedVariable, "Undefined variable: {}, type: {}", node->name, magic_enum::enum_name(node->type()));
     return std::make_unique<IntValue>(0);
 }
 
@@ -359,7 +362,7 @@ std::unique_ptr<Value> Evaluator::_visit_stmt_declaration(const StmtDeclarationN
             m_var_strs[node->name] = std::get<std::string>(value->value);
             break;
         default:
-            ACLG_ERROR("Invalid variable type: {}", node->var_type.value);
+            PPS_ERROR(DiagnosticCode::tInvalidVariableType, "Invalid variable type: {}", node->var_type.value);
             break;
     }
 
@@ -384,7 +387,7 @@ std::unique_ptr<Value> Evaluator::_visit_stmt_assignment(const StmtAssignmentNod
     }
     else
     {
-        ACLG_ERROR("Undefined variable: {}, type: {}", node->name, magic_enum::enum_name(node->type()));
+        PPS_ERROR(DiagnosticCode::tUndefinedVariable, "Undefined variable: {}, type: {}", node->name, magic_enum::enum_name(node->type()));
     }
 
     return value;
@@ -405,13 +408,15 @@ std::unique_ptr<Value> Evaluator::_visit_stmt_condition(const StmtConditionNode*
 
 std::unique_ptr<Value> Evaluator::_visit_stmt_compound(const StmtCompoundNode* node)
 {
-    std::vector<std::unique_ptr<Value>> results;
+    // The value of the last statement is the value of the block
+    std::unique_ptr<Value> result;
     for (auto& stmt : node->statements)
     {
-        results.push_back(evaluate(stmt.get()));
+        check_cancellation();
+        result = evaluate(stmt.get());
     }
 
-    return node->statements.empty() ? std::make_unique<BoolValue>(false) : std::move(results.back());
+    return result ? std::move(result) : std::make_unique<BoolValue>(false);
 }
 
 } // namespace pps
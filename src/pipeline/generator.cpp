@@ -1,6 +1,6 @@
 #include <pipeline/generator.h>
 
-#include <aclg/aclg.h>
+#include <diagnostic.h>
 
 namespace pps
 {
@@ -22,7 +22,7 @@ std::string ExprGenerator::generate(const Node* node)
             return _gen_unary_op_node(static_cast<const UnaryOpNode*>(node));
 
         default:
-            ACLG_ERROR("Unknown node type");
+            PPS_ERROR(DiagnosticCode::tUnknownNode, "Unknown node type");
             return "";
     }
 }
@@ -42,7 +42,7 @@ std::string ExprGenerator::_gen_binary_op_node(const BinaryOpNode* node)
     if (node->op.type == TokenType::tOp_or)
         return "(" + left + " || " + right + ")";
 
-    ACLG_WARN("operator: {} is not supported", node->op.value);
+    PPS_WARN(DiagnosticCode::tUnsupportedOperator, "operator: {} is not supported", node->op.value);
     return "";
 }
 
@@ -53,7 +53,7 @@ std::string ExprGenerator::_gen_unary_op_node(const UnaryOpNode* node)
     if (node->op.type == TokenType::tOp_not)
         return "(!" + child + ")";
 
-    ACLG_WARN("operator: {} is not supported", node->op.value);
+    PPS_WARN(DiagnosticCode::tUnsupportedOperator, "operator: {} is not supported", node->op.value);
     return "";
 }
 
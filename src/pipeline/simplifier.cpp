@@ -1,6 +1,7 @@
 #include <pipeline/simplifier.h>
+#include <pipeline/evaluator.h>
 
-#include <aclg/aclg.h>
+#include <diagnostic.h>
 
 namespace pps
 {
@@ -29,7 +30,7 @@ std::unique_ptr<Node> ExprSimplifier::_simplify_node(const Node* node)
             return _simplify_unary_op_node(static_cast<const UnaryOpNode*>(node));
 
         default:
-            ACLG_ERROR("Unknown node type");
+            PPS_ERROR(DiagnosticCode::tUnknownNode, "Unknown node type");
             return std::unique_ptr<Node>(const_cast<Node*>(node));
     }
 }
@@ -75,4 +76,174 @@ std::unique_ptr<Node> ExprSimplifier::_simplify_unary_op_node(const UnaryOpNode*
     return std::make_unique<UnaryOpNode>(node->op, std::move(child));
 }
 
+ExprSpecializer::ExprSpecializer(const std::unordered_map<std::string, bool>&        bools,
+                                 const std::unordered_map<std::string, int>&         ints,
+                                 const std::unordered_map<std::string, std::string>& strs) :
+    m_bools(bools), m_ints(ints), m_strs(strs) {}
+
+std::unique_ptr<Node> ExprSpecializer::specialize(const Node* node)
+{
+    return _specialize_node(node);
+}
+
+Tristate ExprSpecializer::truth(const Node* node)
+{
+    if (!node || node->type() != NodeType::tLit_bool)
+        return Tristate::tUnknown;
+
+    return static_cast<const LitBoolNode*>(node)->value ? Tristate::tTrue : Tristate::tFalse;
+}
+
+std::string ExprSpecializer::to_source(const Node* node)
+{
+    if (!node)
+        return "";
+
+    switch (node->type())
+    {
+        case NodeType::tLit_int:
+            return std::to_string(static_cast<const LitIntNode*>(node)->value);
+        case NodeType::tLit_bool:
+            return static_cast<const LitBoolNode*>(node)->value ? "true" : "false";
+        case NodeType::tLit_string:
+            return "\"" + static_cast<const LitStringNode*>(node)->value + "\"";
+        case NodeType::tVariable:
+            return static_cast<const VariableNode*>(node)->name;
+        case NodeType::tOp_unary:
+        {
+            auto unary = static_cast<const UnaryOpNode*>(node);
+            auto child = to_source(unary->child.get());
+            if (unary->child->type() == NodeType::tOp_binary)
+                child = "(" + child + ")";
+            return unary->op.value + child;
+        }
+        case NodeType::tOp_binary:
+        {
+            auto binary = static_cast<const BinaryOpNode*>(node);
+            auto left   = to_source(binary->left.get());
+            auto right  = to_source(binary->right.get());
+            if (binary->left->type() == NodeType::tOp_binary)
+                left = "(" + left + ")";
+            if (binary->right->type() == NodeType::tOp_binary)
+                right = "(" + right + ")";
+            return left + " " + binary->op.value + " " + right;
+        }
+        default:
+            PPS_ERROR(DiagnosticCode::tUnknownNode, "Unknown node type");
+            return "";
+    }
+}
+
+std::unique_ptr<Node> ExprSpecializer::_specialize_node(const Node* node)
+{
+    if (!node)
+        return nullptr;
+
+    switch (node->type())
+    {
+        case NodeType::tLit_int:
+            return std::make_unique<LitIntNode>(static_cast<const LitIntNode*>(node)->value);
+
+        case NodeType::tLit_bool:
+            return std::make_unique<LitBoolNode>(static_cast<const LitBoolNode*>(node)->value);
+
+        case NodeType::tLit_string:
+            return std::make_unique<LitStringNode>(static_cast<const LitStringNode*>(node)->value);
+
+        case NodeType::tVariable:
+            return _specialize_variable_node(static_cast<const VariableNode*>(node));
+
+        case NodeType::tOp_binary:
+            return _specialize_binary_op_node(static_cast<const BinaryOpNode*>(node));
+
+        case NodeType::tOp_unary:
+            return _specialize_unary_op_node(static_cast<const UnaryOpNode*>(node));
+
+        default:
+            PPS_ERROR(DiagnosticCode::tUnknownNode, "Unknown node type");
+            return nullptr;
+    }
+}
+
+std::unique_ptr<Node> ExprSpecializer::_specialize_variable_node(const VariableNode* node)
+{
+    auto bool_iter = m_bools.find(node->name);
+    if (bool_iter != m_bools.end())
+        return std::make_unique<LitBoolNode>(bool_iter->second);
+
+    auto int_iter = m_ints.find(node->name);
+    if (int_iter != m_ints.end())
+        return std::make_unique<LitIntNode>(int_iter->second);
+
+    auto str_iter = m_strs.find(node->name);
+    if (str_iter != m_strs.end())
+        return std::make_unique<LitStringNode>(str_iter->second);
+
+    return std::make_unique<VariableNode>(node->name);
+}
+
+std::unique_ptr<Node> ExprSpecializer::_specialize_binary_op_node(const BinaryOpNode* node)
+{
+    auto left  = _specialize_node(node->left.get());
+    auto right = _specialize_node(node->right.get());
+
+    auto left_truth  = truth(left.get());
+    auto right_truth = truth(right.get());
+
+    if (node->op.type == TokenType::tOp_and)
+    {
+        if (left_truth == Tristate::tFalse || right_truth == Tristate::tFalse)
+            return std::make_unique<LitBoolNode>(false);
+        if (left_truth == Tristate::tTrue)
+            return right;
+        if (right_truth == Tristate::tTrue)
+            return left;
+    }
+    else if (node->op.type == TokenType::tOp_or)
+    {
+        if (left_truth == Tristate::tTrue || right_truth == Tristate::tTrue)
+            return std::make_unique<LitBoolNode>(true);
+        if (left_truth == Tristate::tFalse)
+            return right;
+        if (right_truth == Tristate::tFalse)
+            return left;
+    }
+
+    auto is_literal = [](const Node* child) {
+        return child && (child->type() == NodeType::tLit_int ||
+                         child->type() == NodeType::tLit_bool ||
+                         child->type() == NodeType::tLit_string);
+    };
+
+    auto folded = std::make_unique<BinaryOpNode>(node->op, std::move(left), std::move(right));
+    if (!is_literal(folded->left.get()) || !is_literal(folded->right.get()))
+        return folded;
+
+    Evaluator evaluator;
+    auto      value = evaluator.evaluate(folded.get());
+    if (!value)
+        return folded;
+
+    switch (value->type)
+    {
+        case ValueType::tBool:
+            return std::make_unique<LitBoolNode>(std::get<bool>(value->value));
+        case ValueType::tInt:
+            return std::make_unique<LitIntNode>(std::get<int>(value->value));
+        case ValueType::tString:
+            return std::make_unique<LitStringNode>(std::get<std::string>(value->value));
+        default:
+            return folded;
+    }
+}
+
+std::unique_ptr<Node> ExprSpecializer::_specialize_unary_op_node(const UnaryOpNode* node)
+{
+    auto child = _specialize_node(node->child.get());
+    if (node->op.type == TokenType::tOp_not && child && child->type() == NodeType::tLit_bool)
+        return std::make_unique<LitBoolNode>(!static_cast<const LitBoolNode*>(child.get())->value);
+
+    return std::make_unique<UnaryOpNode>(node->op, std::move(child));
+}
+
 } // namespace pps
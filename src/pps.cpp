@@ -1,149 +1,119 @@
 #include <pps/pps.h>
-#include <task.h>
-
-#include <sstream>
-#include <iostream>
+#include <pps/engine.h>
 
 namespace pps
 {
-static int count_blank(const std::string& str)
+
+PPS::PPS()
 {
-    size_t firstNonTab = str.find_first_not_of(' ');
-    if (firstNonTab == std::string::npos)
-    {
-        return str.length();
-    }
-    return firstNonTab;
+    m_engine  = new Engine();
+    m_session = new Session(*m_engine);
 }
 
-static bool start_with(const std::string& str, const std::string& prefix)
+PPS::~PPS()
 {
-    return str.rfind(prefix, 0) == 0;
+    delete m_session;
+    delete m_engine;
 }
 
-static bool end_with(const std::string& str, const std::string& suffix)
+std::string PPS::process(const std::string& source, Context* context)
 {
-    return str.rfind(suffix) == (str.length() - suffix.length());
+    return m_session->process(source, context);
 }
 
-static void format_pps_indent(std::string& line, int& indent_level)
+std::string PPS::process(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
 {
-    if (start_with(line, "{"))
-    {
-        indent_level++;
-    }
-    else if (start_with(line, "}"))
-    {
-        indent_level = std::max(0, indent_level - 1);
-    }
-    else
-    {
-        auto currentIndent = count_blank(line);
-        if (currentIndent < indent_level * 4)
-        {
-            line = std::string(indent_level * 4, ' ') + line;
-        }
-    }
+    return m_session->process(source, context, module_loader, decrypt_key);
 }
 
-static void format_pps_enter(std::string& line)
+void PPS::process_into(std::string& output, const std::string& source, Context* context)
 {
-    if (end_with(line, "}"))
-    {
-        line += "\n";
-    }
+    m_session->process_into(output, source, context);
+}
 
-    line += "\n";
+void PPS::process_into(std::string& output, const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    m_session->process_into(output, source, context, module_loader, decrypt_key);
 }
 
-static void limit_conherent_enters(std::string& str, int maxConsecutive = 2)
+std::string PPS::process(const std::string& source, const LayeredContext& context)
 {
-    if (str.empty() || maxConsecutive < 0)
-        return;
+    return m_session->process(source, context);
+}
 
-    auto is_win_enter = [&](size_t pos) {
-        return pos + 1 < str.length() && str[pos] == '\r' && str[pos + 1] == '\n';
-    };
+std::future<std::string> PPS::process_async(const std::string& source, Context* context)
+{
+    return m_session->process_async(source, context);
+}
 
-    auto is_non_win_enter = [&](size_t pos) {
-        return str[pos] == '\n' || str[pos] == '\r';
-    };
+std::future<std::string> PPS::process_async(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    return m_session->process_async(source, context, module_loader, decrypt_key);
+}
 
-    size_t writePos     = 0;
-    int    newlineCount = 0;
-    for (size_t i = 0; i < str.length(); ++i)
-    {
-        if (is_win_enter(i))
-        {
-            newlineCount++;
-            if (newlineCount <= maxConsecutive)
-            {
-                str[writePos++] = '\n';
-            }
-            ++i;
-        }
-        else if (is_non_win_enter(i))
-        {
-            newlineCount++;
-            if (newlineCount <= maxConsecutive)
-            {
-                str[writePos++] = '\n';
-            }
-        }
-        else
-        {
-            str[writePos++] = str[i];
-            newlineCount    = 0;
-        }
-    }
+std::vector<std::string> PPS::process(const std::string& source, const std::vector<Context*>& contexts)
+{
+    return m_session->process(source, contexts);
+}
 
-    str.resize(writePos);
+std::vector<std::string> PPS::process(const std::string& source, const std::vector<Context*>& contexts, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    return m_session->process(source, contexts, module_loader, decrypt_key);
 }
 
-PPS::PPS()
+void PPS::set_cache(Cache* cache)
 {
-    m_task = new Task();
+    m_engine->set_cache(cache);
 }
 
-PPS::~PPS()
+void PPS::set_file_cache(FileCache* files)
 {
-    delete m_task;
+    m_engine->set_file_cache(files);
 }
 
-std::string PPS::process(const std::string& source, Context* context)
+void PPS::set_executor(Executor* executor)
 {
-    m_task->set_ctx(context);
-    return process(source);
+    m_engine->set_executor(executor);
 }
 
-std::string PPS::process(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+void PPS::set_stats(Stats* stats)
 {
-    m_task->set_ctx(context, module_loader, decrypt_key);
-    return process(source);
+    m_session->set_stats(stats);
 }
 
-std::string PPS::process(const std::string& source)
+void PPS::set_tracer(Tracer* tracer)
 {
-    std::istringstream iss(source);
-    std::string        line;
-    std::string        output;
+    m_session->set_tracer(tracer);
+}
 
-    int indent_level = 0;
+void PPS::set_diagnostics(DiagnosticSink* diagnostics)
+{
+    m_session->set_diagnostics(diagnostics);
+}
 
-    while (std::getline(iss, line))
-    {
-        auto state = m_task->process(line);
-        if (line.empty())
-            continue;
+void PPS::set_cancellation(const CancellationToken* token)
+{
+    m_session->set_cancellation(token);
+}
 
-        format_pps_indent(line, indent_level);
+void PPS::set_memory_resource(std::pmr::memory_resource* resource)
+{
+    m_session->set_memory_resource(resource);
+}
 
-        output += line;
-    }
+const std::vector<std::string>& PPS::dependencies() const
+{
+    return m_session->dependencies();
+}
 
-    limit_conherent_enters(output);
+std::string PPS::specialize(const std::string& source, Context* context)
+{
+    return m_session->specialize(source, context);
+}
 
-    return output;
+std::string PPS::specialize(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    return m_session->specialize(source, context, module_loader, decrypt_key);
 }
 
 } // namespace pps
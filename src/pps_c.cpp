@@ -0,0 +1,276 @@
+#include <pps/pps_c.h>
+#include <pps/engine.h>
+
+#include <cstring>
+#include <exception>
+
+struct pps_engine
+{
+    pps::Engine engine;
+};
+
+struct pps_session
+{
+    explicit pps_session(const pps::Engine& engine) :
+        session(engine) {}
+
+    pps::Session session;
+
+    // Reused across calls, so that a steady loop allocates nothing
+    std::string source;
+    std::string output;
+    std::string error;
+};
+
+struct pps_template
+{
+    explicit pps_template(std::string source) :
+        prepared(std::move(source)) {}
+
+    pps::Template prepared;
+};
+
+struct pps_context
+{
+    pps::Context context;
+};
+
+template <class Call>
+static pps_status guard(pps_session* session, Call&& call)
+{
+    try
+    {
+        session->error.clear();
+        call();
+        return PPS_OK;
+    }
+    catch (const std::exception& e)
+    {
+        session->output.clear();
+        session->error = e.what();
+    }
+    catch (...)
+    {
+        session->output.clear();
+        session->error = "unknown error";
+    }
+    return PPS_FAILED;
+}
+
+static bool valid_strings(const char* const* strings, size_t count)
+{
+    if (count && !strings)
+        return false;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!strings[i])
+            return false;
+    }
+    return true;
+}
+
+// Integer values convert to bools as in C: anything but 0 is true
+template <class Value, class Map>
+static pps_status set_values(Map& map, const char* const* names, const Value* values, size_t count)
+{
+    if (!valid_strings(names, count) || (count && !values))
+        return PPS_INVALID_ARGUMENT;
+
+    try
+    {
+        for (size_t i = 0; i < count; i++)
+            map[names[i]] = values[i];
+    }
+    catch (...)
+    {
+        return PPS_FAILED;
+    }
+    return PPS_OK;
+}
+
+static pps_status copy_output(const std::string& output, char* buffer, size_t capacity, size_t* size)
+{
+    if (size)
+        *size = output.size();
+    if (output.size() > capacity)
+        return PPS_BUFFER_TOO_SMALL;
+
+    if (!output.empty())
+        std::memcpy(buffer, output.data(), output.size());
+    return PPS_OK;
+}
+
+extern "C" {
+
+pps_engine* pps_engine_create(void)
+{
+    try
+    {
+        return new pps_engine();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void pps_engine_destroy(pps_engine* engine)
+{
+    delete engine;
+}
+
+void pps_engine_set_parallel_threshold(pps_engine* engine, size_t bytes)
+{
+    if (engine)
+        engine->engine.set_parallel_threshold(bytes);
+}
+
+void pps_engine_set_include_once(pps_engine* engine, int once)
+{
+    if (engine)
+        engine->engine.set_include_once(once != 0);
+}
+
+pps_session* pps_session_create(const pps_engine* engine)
+{
+    if (!engine)
+        return nullptr;
+
+    try
+    {
+        return new pps_session(engine->engine);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void pps_session_destroy(pps_session* session)
+{
+    delete session;
+}
+
+pps_template* pps_template_create(const char* source, size_t size)
+{
+    if (!source && size)
+        return nullptr;
+
+    try
+    {
+        return new pps_template(std::string(source ? source : "", size));
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void pps_template_destroy(pps_template* prepared)
+{
+    delete prepared;
+}
+
+pps_context* pps_context_create(void)
+{
+    try
+    {
+        return new pps_context();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void pps_context_destroy(pps_context* context)
+{
+    delete context;
+}
+
+void pps_context_clear(pps_context* context)
+{
+    if (context)
+        context->context = {};
+}
+
+void pps_context_set_static(pps_context* context, int is_static)
+{
+    if (context)
+        context->context.isStatic = is_static != 0;
+}
+
+pps_status pps_context_set_bools(pps_context* context, const char* const* names, const int* values, size_t count)
+{
+    return context ? set_values(context->context.bools, names, values, count) : PPS_INVALID_ARGUMENT;
+}
+
+pps_status pps_context_set_ints(pps_context* context, const char* const* names, const int* values, size_t count)
+{
+    return context ? set_values(context->context.ints, names, values, count) : PPS_INVALID_ARGUMENT;
+}
+
+pps_status pps_context_set_strings(pps_context* context, const char* const* names, const char* const* values, size_t count)
+{
+    if (!context || !valid_strings(values, count))
+        return PPS_INVALID_ARGUMENT;
+    return set_values(context->context.strings, names, values, count);
+}
+
+pps_status pps_context_set_instances(pps_context* context, const char* const* names, const char* const* values, size_t count)
+{
+    if (!context || !valid_strings(values, count))
+        return PPS_INVALID_ARGUMENT;
+    return set_values(context->context.instances, names, values, count);
+}
+
+pps_status pps_context_add_prefixes(pps_context* context, const char* const* prefixes, size_t count)
+{
+    if (!context || !valid_strings(prefixes, count))
+        return PPS_INVALID_ARGUMENT;
+
+    try
+    {
+        context->context.prefixes.insert(prefixes, prefixes + count);
+    }
+    catch (...)
+    {
+        return PPS_FAILED;
+    }
+    return PPS_OK;
+}
+
+pps_status pps_session_process(pps_session* session, const pps_template* prepared, pps_context* context, char* buffer, size_t capacity, size_t* size)
+{
+    if (!session || !prepared || !context || (!buffer && capacity))
+        return PPS_INVALID_ARGUMENT;
+
+    auto status = guard(session, [&]() { session->session.process_into(session->output, prepared->prepared, &context->context); });
+    return status == PPS_OK ? copy_output(session->output, buffer, capacity, size) : status;
+}
+
+pps_status pps_session_process_source(pps_session* session, const char* source, size_t source_size, pps_context* context, char* buffer, size_t capacity, size_t* size)
+{
+    if (!session || (!source && source_size) || !context || (!buffer && capacity))
+        return PPS_INVALID_ARGUMENT;
+
+    auto status = guard(session, [&]() {
+        session->source.assign(source ? source : "", source_size);
+        session->session.process_into(session->output, session->source, &context->context);
+    });
+    return status == PPS_OK ? copy_output(session->output, buffer, capacity, size) : status;
+}
+
+pps_status pps_session_read_output(const pps_session* session, char* buffer, size_t capacity, size_t* size)
+{
+    if (!session || (!buffer && capacity))
+        return PPS_INVALID_ARGUMENT;
+    return copy_output(session->output, buffer, capacity, size);
+}
+
+const char* pps_session_last_error(const pps_session* session)
+{
+    return session ? session->error.c_str() : "";
+}
+
+} // extern "C"
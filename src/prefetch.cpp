@@ -0,0 +1,96 @@
+#include <prefetch.h>
+#include <pps/executor.h>
+#include <pps/include_provider.h>
+
+#include <sstream>
+
+namespace pps
+{
+
+IncludePrefetch::IncludePrefetch(Executor& executor, const Context& context, IncludeProvider* provider, FileCache* files, sbin::Loader* module_loader, const std::string& decrypt_key) :
+    m_executor(executor), m_context(context), m_provider(provider), m_files(files), m_loader(module_loader), m_decrypt_key(decrypt_key) {}
+
+void IncludePrefetch::scan(const std::string& source)
+{
+    std::istringstream       iss(source);
+    std::string              line;
+    std::string              path;
+    std::vector<std::string> paths;
+    while (std::getline(iss, line))
+    {
+        if (!Task::extract_include(line, path))
+            continue;
+
+        std::shared_ptr<Read> read;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto&                       slot = m_reads[path];
+            if (m_finished || slot)
+                continue;
+
+            read = slot = std::make_shared<Read>();
+        }
+        paths.push_back(path);
+
+        m_executor.post([self = shared_from_this(), read, path]() {
+            if (!read->claimed.exchange(true))
+                self->_run(*read, path);
+        });
+    }
+
+    if (m_provider && !paths.empty())
+        m_provider->prefetch(paths, m_context.prefixes);
+}
+
+IncludeRead IncludePrefetch::take(const std::string& path)
+{
+    std::shared_ptr<Read> read;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto&                       slot = m_reads[path];
+        if (!slot)
+            slot = std::make_shared<Read>();
+        read = slot;
+    }
+
+    if (!read->claimed.exchange(true))
+        _run(*read, path);
+    return read->result.get();
+}
+
+void IncludePrefetch::finish()
+{
+    std::vector<std::shared_ptr<Read>> reads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+        for (const auto& [path, read] : m_reads)
+            reads.push_back(read);
+    }
+
+    for (const auto& read : reads)
+    {
+        if (read->claimed.exchange(true))
+            read->result.wait();
+    }
+}
+
+void IncludePrefetch::_run(Read& read, const std::string& path)
+{
+    IncludeRead result;
+    try
+    {
+        result = Task::read_include(path, m_context, m_provider, m_files, m_loader, m_decrypt_key, nullptr);
+    }
+    catch (...)
+    {
+        read.promise.set_exception(std::current_exception());
+        return;
+    }
+
+    read.promise.set_value(std::move(result));
+    if (auto content = read.result.get().content)
+        scan(*content);
+}
+
+} // namespace pps
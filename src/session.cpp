@@ -0,0 +1,711 @@
+#include <pps/engine.h>
+#include <pps/cache.h>
+#include <pps/executor.h>
+#include <pps/include_provider.h>
+#include <pps/layered_context.h>
+#include <task.h>
+#include <format.h>
+#include <permutator.h>
+#include <prefetch.h>
+#include <include_memo.h>
+#include <stage_timer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace pps
+{
+static void record_bytes(Stats* stats, const std::string& source, const std::string& output)
+{
+    if (!stats)
+        return;
+
+    stats->bytes_in += source.size();
+    stats->bytes_out += output.size();
+}
+
+static void record_bytes(Stats* stats, const std::string& source, const std::vector<std::string>& outputs)
+{
+    if (!stats)
+        return;
+
+    stats->bytes_in += source.size();
+    for (const auto& output : outputs)
+        stats->bytes_out += output.size();
+}
+
+// Clears the task's stats when the call ends, as they can be local to the call's StatsScope
+struct DetachStats
+{
+    Task* task;
+
+    ~DetachStats() { task->set_stats(nullptr); }
+};
+
+// Appends to a caller's string, for the calls that return the whole output
+class StringSink : public OutputSink
+{
+    std::string& m_output;
+
+public:
+    explicit StringSink(std::string& output) :
+        m_output(output) {}
+
+    void append(std::string_view piece) override { m_output += piece; }
+};
+
+// Consecutive top-level regions processed by one copy of the task
+struct RegionChunk
+{
+    size_t                   begin = 0;
+    size_t                   end   = 0;
+    std::vector<std::string> lines;
+    std::vector<std::string> reads;
+    std::vector<std::string> dependencies;
+    std::vector<std::string> misses;
+    Stats                    stats;
+    DiagnosticBuffer         diagnostics;
+    TraceBuffer              trace;
+    std::set<std::string>    once;
+    bool                     balanced = false;
+    std::exception_ptr       error;
+};
+
+// Executor jobs helping a call; the call only waits for the ones that started
+struct RegionHelpers
+{
+    std::mutex              mutex;
+    std::condition_variable idle;
+    size_t                  active = 0;
+    bool                    closed = false;
+};
+
+Session::Session(const Engine& engine) :
+    m_engine(&engine)
+{
+    m_task = new Task();
+    m_memo = new IncludeMemo();
+    m_task->set_dependencies(&m_dependencies);
+    m_task->set_misses(&m_misses);
+}
+
+Session::~Session()
+{
+    delete m_memo;
+    delete m_task;
+}
+
+std::string Session::process(const std::string& source, Context* context)
+{
+    return process(source, context, nullptr, "");
+}
+
+std::string Session::process(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    std::string output;
+    process_into(output, source, context, module_loader, decrypt_key);
+    return output;
+}
+
+std::string Session::process(const Template& source, Context* context)
+{
+    return process(source, context, nullptr, "");
+}
+
+std::string Session::process(const Template& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    std::string output;
+    process_into(output, source, context, module_loader, decrypt_key);
+    return output;
+}
+
+void Session::process_into(std::string& output, const std::string& source, Context* context)
+{
+    process_into(output, source, context, nullptr, "");
+}
+
+void Session::process_into(std::string& output, const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    StatsScope        stats(m_stats, m_engine->stats());
+    DetachStats       detach{m_task};
+    DiagnosticScope   diagnostics(m_diagnostics ? m_diagnostics : m_engine->diagnostics());
+    CancellationScope cancellation(m_cancellation);
+    MemoryScope       memory(m_memory);
+    TraceScope        trace(_begin(stats.get(), context, module_loader, decrypt_key), "process", "process");
+    if (m_engine->cache())
+        _process_cached(source, nullptr, context, module_loader, decrypt_key, output);
+    else
+        _process(source, nullptr, output);
+}
+
+void Session::process_into(std::string& output, const Template& source, Context* context)
+{
+    process_into(output, source, context, nullptr, "");
+}
+
+void Session::process_into(std::string& output, const Template& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    StatsScope        stats(m_stats, m_engine->stats());
+    DetachStats       detach{m_task};
+    DiagnosticScope   diagnostics(m_diagnostics ? m_diagnostics : m_engine->diagnostics());
+    CancellationScope cancellation(m_cancellation);
+    MemoryScope       memory(m_memory);
+    TraceScope        trace(_begin(stats.get(), context, module_loader, decrypt_key), "process", "process");
+    if (auto provider = m_engine->include_provider(); provider && !source.includes().empty())
+        provider->prefetch(source.includes(), context->prefixes);
+    if (m_engine->cache())
+        _process_cached(source.source(), &source, context, module_loader, decrypt_key, output);
+    else
+        _process(source.source(), &source, output);
+}
+
+void Session::process_into(OutputSink& sink, const Template& source, Context* context)
+{
+    process_into(sink, source, context, nullptr, "");
+}
+
+void Session::process_into(OutputSink& sink, const Template& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    StatsScope        stats(m_stats, m_engine->stats());
+    DetachStats       detach{m_task};
+    DiagnosticScope   diagnostics(m_diagnostics ? m_diagnostics : m_engine->diagnostics());
+    CancellationScope cancellation(m_cancellation);
+    MemoryScope       memory(m_memory);
+    TraceScope        trace(_begin(stats.get(), context, module_loader, decrypt_key), "process", "process");
+    if (auto provider = m_engine->include_provider(); provider && !source.includes().empty())
+        provider->prefetch(source.includes(), context->prefixes);
+    if (!m_engine->cache())
+    {
+        _process(source.source(), &source, sink);
+        return;
+    }
+
+    // The cache stores whole outputs, so they are built in the session's buffer first
+    _process_cached(source.source(), &source, context, module_loader, decrypt_key, m_buffer);
+    sink.reserve(m_buffer.size());
+    sink.append(m_buffer);
+}
+
+template <class Call>
+auto Session::_with_layer(const LayeredContext& context, Call&& call)
+{
+    if (m_layer_base != context.base())
+    {
+        m_layer      = *context.base();
+        m_layer_base = context.base();
+    }
+
+    // Restores the copy to the base even when the call throws
+    struct Revert
+    {
+        const LayeredContext& context;
+        Context&              target;
+
+        ~Revert() { context.revert(target); }
+    } revert{context, m_layer};
+
+    context.apply(m_layer);
+    return call(&m_layer);
+}
+
+std::string Session::process(const std::string& source, const LayeredContext& context)
+{
+    return process(source, context, nullptr, "");
+}
+
+std::string Session::process(const std::string& source, const LayeredContext& context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    return _with_layer(context, [&](Context* layered) { return process(source, layered, module_loader, decrypt_key); });
+}
+
+std::string Session::process(const Template& source, const LayeredContext& context)
+{
+    return process(source, context, nullptr, "");
+}
+
+std::string Session::process(const Template& source, const LayeredContext& context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    return _with_layer(context, [&](Context* layered) { return process(source, layered, module_loader, decrypt_key); });
+}
+
+void Session::process_into(std::string& output, const Template& source, const LayeredContext& context)
+{
+    _with_layer(context, [&](Context* layered) { process_into(output, source, layered); });
+}
+
+std::future<std::string> Session::process_async(const std::string& source, Context* context)
+{
+    return process_async(source, context, nullptr, "");
+}
+
+std::future<std::string> Session::process_async(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    auto& executor = m_engine->executor() ? *m_engine->executor() : default_executor();
+    auto  job      = std::make_shared<std::packaged_task<std::string()>>([=, this, &executor]() {
+        auto prefetch = std::make_shared<IncludePrefetch>(executor, *context, m_engine->include_provider(), m_engine->file_cache(), module_loader, decrypt_key);
+        prefetch->scan(source);
+
+        // Reads still queued when the call returns are dropped, running ones awaited
+        struct Detach
+        {
+            Task*            task;
+            IncludePrefetch* prefetch;
+
+            ~Detach()
+            {
+                task->set_prefetch(nullptr);
+                prefetch->finish();
+            }
+        } detach{m_task, prefetch.get()};
+
+        m_task->set_prefetch(prefetch.get());
+        return process(source, context, module_loader, decrypt_key);
+    });
+
+    auto result = job->get_future();
+    executor.post([job]() { (*job)(); });
+    return result;
+}
+
+std::vector<std::string> Session::process(const std::string& source, const std::vector<Context*>& contexts)
+{
+    return process(source, contexts, nullptr, "");
+}
+
+std::vector<std::string> Session::process(const std::string& source, const std::vector<Context*>& contexts, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    StatsScope        stats(m_stats, m_engine->stats());
+    DetachStats       detach{m_task};
+    DiagnosticScope   diagnostics(m_diagnostics ? m_diagnostics : m_engine->diagnostics());
+    CancellationScope cancellation(m_cancellation);
+    MemoryScope       memory(m_memory);
+    TraceScope        trace(_begin(stats.get(), nullptr, module_loader, decrypt_key), "process", "process_batch");
+    m_dependencies.clear();
+    m_misses.clear();
+
+    Permutator permutator(*m_task, contexts);
+    auto       outputs = permutator.process(source);
+    record_bytes(stats.get(), source, outputs);
+    return outputs;
+}
+
+std::string Session::specialize(const std::string& source, Context* context)
+{
+    return specialize(source, context, nullptr, "");
+}
+
+std::string Session::specialize(const std::string& source, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    StatsScope        stats(m_stats, m_engine->stats());
+    DetachStats       detach{m_task};
+    DiagnosticScope   diagnostics(m_diagnostics ? m_diagnostics : m_engine->diagnostics());
+    CancellationScope cancellation(m_cancellation);
+    MemoryScope       memory(m_memory);
+    TraceScope        trace(_begin(stats.get(), context, module_loader, decrypt_key), "process", "specialize");
+    return _specialize(source);
+}
+
+void Session::set_stats(Stats* stats)
+{
+    m_stats = stats;
+}
+
+void Session::set_tracer(Tracer* tracer)
+{
+    m_tracer = tracer;
+}
+
+void Session::set_diagnostics(DiagnosticSink* diagnostics)
+{
+    m_diagnostics = diagnostics;
+}
+
+void Session::set_cancellation(const CancellationToken* token)
+{
+    m_cancellation = token;
+}
+
+void Session::set_memory_resource(std::pmr::memory_resource* resource)
+{
+    m_memory = resource;
+}
+
+const std::vector<std::string>& Session::dependencies() const
+{
+    return m_dependencies;
+}
+
+const std::vector<std::string>& Session::misses() const
+{
+    return m_misses;
+}
+
+Tracer* Session::_begin(Stats* stats, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key)
+{
+    // A call whose token is already done does no work at all
+    check_cancellation();
+
+    auto tracer = m_tracer ? m_tracer : m_engine->tracer();
+    if (!tracer)
+        tracer = global_tracer();
+
+    m_memo->clear();
+    m_task->reset();
+    m_task->set_ctx(context, module_loader, decrypt_key);
+    m_task->set_file_cache(m_engine->file_cache());
+    m_task->set_include_provider(m_engine->include_provider());
+    m_task->set_include_once(m_engine->include_once());
+    m_task->set_include_memo(m_engine->include_memo() ? m_memo : nullptr);
+    m_task->set_stats(stats);
+    m_task->set_tracer(tracer);
+    return tracer;
+}
+
+void Session::_process(const std::string& source, const Template* prepared, std::string& output)
+{
+    StringSink sink(output);
+    output.clear();
+    output.reserve(_output_hint(source, prepared));
+
+    // A failed or cancelled call leaves no partial output, only the capacity
+    try
+    {
+        _process_lines(source, prepared, sink, nullptr);
+    }
+    catch (...)
+    {
+        output.clear();
+        throw;
+    }
+
+    {
+        StageTimer timer(m_task->stats(), Stage::tFormat);
+        limit_conherent_enters(output);
+    }
+
+    _record_output(source, prepared, output.size());
+    record_bytes(m_task->stats(), source, output);
+}
+
+void Session::_process(const std::string& source, const Template* prepared, OutputSink& sink)
+{
+    sink.reserve(_output_hint(source, prepared));
+
+    int  enters = 0;
+    auto size   = _process_lines(source, prepared, sink, &enters);
+
+    _record_output(source, prepared, size);
+    if (auto stats = m_task->stats())
+    {
+        stats->bytes_in += source.size();
+        stats->bytes_out += size;
+    }
+}
+
+size_t Session::_process_lines(const std::string& source, const Template* prepared, OutputSink& sink, int* enters)
+{
+    m_dependencies.clear();
+    m_misses.clear();
+
+    size_t size         = 0;
+    int    indent_level = 0;
+
+    auto append = [&](std::string& line) {
+        if (line.empty())
+            return;
+
+        {
+            StageTimer timer(m_task->stats(), Stage::tFormat);
+            format_pps_indent(line, indent_level);
+            if (enters)
+                limit_conherent_enters(line, 2, *enters);
+        }
+
+        StageTimer timer(m_task->stats(), Stage::tOutput);
+        size += line.size();
+        sink.append(line);
+    };
+
+    auto                     threshold = m_engine->parallel_threshold();
+    std::vector<std::string> processed;
+    std::string              line;
+    if (threshold && source.size() >= threshold && _process_regions(source, prepared, processed))
+    {
+        for (auto& region_line : processed)
+            append(region_line);
+    }
+    else if (prepared)
+    {
+        for (const auto& entry : prepared->lines())
+        {
+            line.assign(source, entry.offset, entry.size);
+            if (entry.directive)
+                m_task->process(line);
+            else
+                m_task->process_origin(line);
+            append(line);
+        }
+    }
+    else
+    {
+        std::istringstream iss(source);
+        while (std::getline(iss, line))
+        {
+            m_task->process(line);
+            append(line);
+        }
+    }
+    return size;
+}
+
+size_t Session::_output_hint(const std::string& source, const Template* prepared) const
+{
+    if (prepared)
+        return prepared->output_hint();
+    if (source.data() == m_hint_source && source.size() == m_hint_size)
+        return m_output_hint;
+    return 0;
+}
+
+void Session::_record_output(const std::string& source, const Template* prepared, size_t size)
+{
+    if (prepared)
+    {
+        prepared->record_output(size);
+        return;
+    }
+
+    if (source.data() != m_hint_source || source.size() != m_hint_size)
+    {
+        m_hint_source = source.data();
+        m_hint_size   = source.size();
+        m_output_hint = 0;
+    }
+    m_output_hint = std::max(m_output_hint, size);
+}
+
+bool Session::_process_regions(const std::string& source, const Template* prepared, std::vector<std::string>& processed)
+{
+    // Without a template, only lines that can hold a directive are scanned for branches
+    std::vector<Template::Line> split;
+    if (!prepared)
+    {
+        for (size_t offset = 0; offset < source.size();)
+        {
+            auto end = std::min(source.find('\n', offset), source.size());
+            split.push_back({offset, end - offset, std::string_view(source).substr(offset, end - offset).find("*<$") != std::string_view::npos});
+            offset = end + 1;
+        }
+    }
+    const auto& lines = prepared ? prepared->lines() : split;
+
+    // Cut where no branch is open, into a few chunks per hardware thread
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t target  = std::max<size_t>(source.size() / (workers * 4), 1);
+
+    std::vector<RegionChunk> chunks(1);
+    size_t                   bytes = 0;
+    int                      depth = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        const auto& line = lines[i];
+        if (line.directive)
+            depth += Task::branch_delta(source.substr(line.offset, line.size));
+        if (depth < 0)
+            return false;
+
+        bytes += line.size + 1;
+        if (depth == 0 && bytes >= target && i + 1 < lines.size())
+        {
+            chunks.back().end = i + 1;
+            chunks.emplace_back().begin = i + 1;
+            bytes                       = 0;
+        }
+    }
+    chunks.back().end = lines.size();
+    if (chunks.size() < 2)
+        return false;
+
+    auto                stats    = m_task->stats();
+    auto                sink     = t_diagnostic_target.sink;
+    auto                tracer   = m_task->tracer();
+    auto                token    = t_cancellation;
+    auto                resource = t_memory_resource;
+    auto                caller   = std::this_thread::get_id();
+    std::atomic<size_t> next     = 0;
+
+    auto run = [&]() {
+        for (size_t index = next++; index < chunks.size(); index = next++)
+        {
+            auto& chunk = chunks[index];
+            Task  task  = *m_task;
+            task.set_line(uint32_t(chunk.begin));
+            task.set_stats(stats ? &chunk.stats : nullptr);
+            task.set_reads(m_task->reads() ? &chunk.reads : nullptr);
+            task.set_dependencies(&chunk.dependencies);
+            task.set_misses(&chunk.misses);
+            task.set_tracer(tracer ? &chunk.trace : nullptr);
+
+            std::optional<StatsScope> scope;
+            if (stats)
+                scope.emplace(&chunk.stats, nullptr);
+            DiagnosticScope   diagnostics(&chunk.diagnostics);
+            CancellationScope cancellation(token);
+
+            // The resource is not shared between threads
+            MemoryScope memory(std::this_thread::get_id() == caller ? resource : nullptr);
+
+            try
+            {
+                std::string line;
+                for (size_t i = chunk.begin; i < chunk.end; i++)
+                {
+                    line.assign(source, lines[i].offset, lines[i].size);
+                    if (prepared && !lines[i].directive)
+                        task.process_origin(line);
+                    else
+                        task.process(line);
+
+                    if (!line.empty())
+                        chunk.lines.push_back(std::move(line));
+                }
+
+                // Includes can still leave a branch open across the cut
+                chunk.balanced = task.at_top_level();
+                chunk.once     = task.once();
+            }
+            catch (...)
+            {
+                chunk.error = std::current_exception();
+            }
+        }
+    };
+
+    // Helpers that start after the call returned find it closed and never touch `run`
+    auto& executor = m_engine->executor() ? *m_engine->executor() : default_executor();
+    auto  helpers  = std::make_shared<RegionHelpers>();
+    for (size_t i = 1; i < std::min(chunks.size(), workers); i++)
+    {
+        executor.post([helpers, &run]() {
+            {
+                std::lock_guard<std::mutex> lock(helpers->mutex);
+                if (helpers->closed)
+                    return;
+                helpers->active++;
+            }
+
+            run();
+
+            std::lock_guard<std::mutex> lock(helpers->mutex);
+            helpers->active--;
+            helpers->idle.notify_all();
+        });
+    }
+
+    run();
+    {
+        std::unique_lock<std::mutex> lock(helpers->mutex);
+        helpers->closed = true;
+        helpers->idle.wait(lock, [&]() { return helpers->active == 0; });
+    }
+
+    // A chunk is only valid when every chunk before it ended with no branch open,
+    // and did not expand an include-once file that a chunk before it expanded.
+    // Diagnostics and trace events of a rejected split are dropped with it, since
+    // the sequential pass reports them again.
+    std::set<std::string> once;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        auto& chunk = chunks[i];
+        if (chunk.error)
+        {
+            // What led up to the error is reported, as a sequential pass would have
+            for (size_t j = 0; j <= i; j++)
+                chunks[j].diagnostics.forward(sink);
+            std::rethrow_exception(chunk.error);
+        }
+        if (!chunk.balanced)
+            return false;
+
+        for (const auto& key : chunk.once)
+        {
+            if (!once.insert(key).second)
+                return false;
+        }
+    }
+
+    for (auto& chunk : chunks)
+    {
+        if (stats)
+            *stats += chunk.stats;
+        chunk.diagnostics.forward(sink);
+        if (tracer)
+            chunk.trace.replay(*tracer);
+        if (m_task->reads())
+            m_task->reads()->insert(m_task->reads()->end(), chunk.reads.begin(), chunk.reads.end());
+        m_dependencies.insert(m_dependencies.end(), chunk.dependencies.begin(), chunk.dependencies.end());
+        m_misses.insert(m_misses.end(), chunk.misses.begin(), chunk.misses.end());
+        for (auto& line : chunk.lines)
+            processed.push_back(std::move(line));
+    }
+    return true;
+}
+
+std::string Session::_specialize(const std::string& source)
+{
+    m_dependencies.clear();
+    m_misses.clear();
+
+    std::istringstream iss(source);
+    std::string        line;
+    std::string        output;
+
+    m_task->set_partial(true);
+    while (std::getline(iss, line))
+    {
+        m_task->process(line);
+        if (line.empty())
+            continue;
+
+        StageTimer timer(m_task->stats(), Stage::tOutput);
+        output += line;
+        if (output.back() != '\n')
+            output += '\n';
+    }
+    m_task->set_partial(false);
+
+    record_bytes(m_task->stats(), source, output);
+    return output;
+}
+
+void Session::_process_cached(const std::string& source, const Template* prepared, Context* context, sbin::Loader* module_loader, const std::string& decrypt_key, std::string& output)
+{
+    auto cache    = m_engine->cache();
+    auto provider = m_engine->include_provider();
+    auto stats    = m_task->stats();
+    if (cache->lookup(source, *context, module_loader, decrypt_key, output, &m_dependencies, provider, &m_misses))
+    {
+        if (stats)
+            stats->cache_hits++;
+        record_bytes(stats, source, output);
+        return;
+    }
+
+    if (stats)
+        stats->cache_misses++;
+
+    std::vector<std::string> reads;
+    m_task->set_reads(&reads);
+    _process(source, prepared, output);
+    m_task->set_reads(nullptr);
+
+    cache->store(source, *context, reads, m_dependencies, m_misses, module_loader, decrypt_key, output, provider);
+}
+
+} // namespace pps
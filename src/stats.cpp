@@ -0,0 +1,161 @@
+#include <pps/stats.h>
+#include <stage_timer.h>
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+namespace pps
+{
+
+static std::atomic<Stats*> g_global_stats = nullptr;
+static std::mutex          g_merge_mutex;
+
+void set_global_stats(Stats* stats)
+{
+    g_global_stats = stats;
+}
+
+void record_allocation(size_t size)
+{
+    auto& target = t_allocation_target;
+    if (!target.stats)
+        return;
+
+    target.stats->allocations++;
+    target.stats->allocated_bytes += size;
+    if (target.stage == Stage::tCount)
+        return;
+
+    auto& stage = target.stats->stages[size_t(target.stage)];
+    stage.allocations++;
+    stage.allocated_bytes += size;
+}
+
+StatsScope::StatsScope(Stats* own, Stats* shared) :
+    m_outer(t_allocation_target)
+{
+    if (own)
+        m_target = own;
+    else if ((m_shared = shared ? shared : g_global_stats.load()))
+        m_target = &m_local;
+
+    t_allocation_target = {m_target, Stage::tCount};
+}
+
+StatsScope::~StatsScope()
+{
+    t_allocation_target = m_outer;
+    if (!m_shared)
+        return;
+
+    std::lock_guard<std::mutex> lock(g_merge_mutex);
+    *m_shared += m_local;
+}
+
+Stats& Stats::operator+=(const Stats& other)
+{
+    for (size_t i = 0; i < size_t(Stage::tCount); i++)
+    {
+        stages[i].nanoseconds += other.stages[i].nanoseconds;
+        stages[i].count += other.stages[i].count;
+        stages[i].allocations += other.stages[i].allocations;
+        stages[i].allocated_bytes += other.stages[i].allocated_bytes;
+    }
+    for (size_t i = 0; i < size_t(Directive::tCount); i++)
+        directives[i] += other.directives[i];
+
+    bytes_in += other.bytes_in;
+    bytes_out += other.bytes_out;
+    lines += other.lines;
+    cache_hits += other.cache_hits;
+    cache_misses += other.cache_misses;
+    allocations += other.allocations;
+    allocated_bytes += other.allocated_bytes;
+    return *this;
+}
+
+void Stats::reset()
+{
+    *this = Stats();
+}
+
+std::string Stats::to_json() const
+{
+    std::ostringstream oss;
+    oss << "{\n  \"stages\": {";
+    for (size_t i = 0; i < size_t(Stage::tCount); i++)
+    {
+        oss << (i ? "," : "") << "\n    \"" << name(Stage(i)) << "\": {\"count\": " << stages[i].count
+            << ", \"ns\": " << stages[i].nanoseconds << ", \"allocations\": " << stages[i].allocations
+            << ", \"allocated_bytes\": " << stages[i].allocated_bytes << "}";
+    }
+    oss << "\n  },\n  \"directives\": {";
+    for (size_t i = 0; i < size_t(Directive::tCount); i++)
+        oss << (i ? ", " : "") << "\"" << name(Directive(i)) << "\": " << directives[i];
+    oss << "},\n"
+        << "  \"bytes_in\": " << bytes_in << ",\n"
+        << "  \"bytes_out\": " << bytes_out << ",\n"
+        << "  \"lines\": " << lines << ",\n"
+        << "  \"cache\": {\"hits\": " << cache_hits << ", \"misses\": " << cache_misses << "},\n"
+        << "  \"allocations\": " << allocations << ",\n"
+        << "  \"allocated_bytes\": " << allocated_bytes << "\n"
+        << "}";
+    return oss.str();
+}
+
+const char* Stats::name(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::tScan:
+            return "scan";
+        case Stage::tLex:
+            return "lex";
+        case Stage::tParse:
+            return "parse";
+        case Stage::tEvaluate:
+            return "evaluate";
+        case Stage::tSimplify:
+            return "simplify";
+        case Stage::tGenerate:
+            return "generate";
+        case Stage::tInclude:
+            return "include";
+        case Stage::tIncludeIO:
+            return "include_io";
+        case Stage::tLoader:
+            return "loader";
+        case Stage::tFormat:
+            return "format";
+        case Stage::tOutput:
+            return "output";
+        default:
+            return "unknown";
+    }
+}
+
+const char* Stats::name(Directive directive)
+{
+    switch (directive)
+    {
+        case Directive::tStatic:
+            return "static";
+        case Directive::tDynamic:
+            return "dynamic";
+        case Directive::tInclude:
+            return "include";
+        case Directive::tOverride:
+            return "override";
+        case Directive::tEmbed:
+            return "embed";
+        case Directive::tProg:
+            return "prog";
+        case Directive::tPragma:
+            return "pragma";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace pps
@@ -4,6 +4,12 @@
 
 #include <sbin/loader.h>
 
+#include <pps/file_cache.h>
+#include <pps/include_provider.h>
+#include <stage_timer.h>
+#include <prefetch.h>
+#include <include_memo.h>
+
 #include <aclg/aclg.h>
 
 #include <regex>
@@ -11,6 +17,7 @@
 #include <iostream>
 #include <filesystem>
 #include <sstream>
+#include <algorithm>
 
 namespace pps
 {
@@ -23,12 +30,15 @@ static auto g_task_include  = std::regex(R"(include (.+))");
 static auto g_task_override = std::regex(R"(override (.+))");
 static auto g_task_embed    = std::regex(R"(embed .+)");
 static auto g_task_prog     = std::regex(R"(prog .+)");
+static auto g_task_once     = std::regex(R"(pragma once)");
 
 static auto g_branch_if    = std::regex(R"(if (.+))");
 static auto g_branch_elif  = std::regex(R"(elif (.+))");
 static auto g_branch_else  = std::regex(R"(else)");
 static auto g_branch_endif = std::regex(R"(endif)");
 
+static auto g_override_expr = std::regex(R"((\w+)\s*(/\*<\$override[^>]*>\*/))");
+
 Task::Task()
 {
 }
@@ -45,22 +55,130 @@ void Task::set_ctx(Context* context, sbin::Loader* module_loader, const std::str
     m_decrypt_key = decrypt_key;
 }
 
+void Task::set_partial(bool partial)
+{
+    m_partial = partial;
+}
+
+void Task::set_reads(std::vector<std::string>* reads)
+{
+    m_reads = reads;
+}
+
+void Task::set_dependencies(std::vector<std::string>* dependencies)
+{
+    m_dependencies = dependencies;
+}
+
+void Task::set_misses(std::vector<std::string>* misses)
+{
+    m_misses = misses;
+}
+
+void Task::set_file_cache(FileCache* files)
+{
+    m_files = files;
+}
+
+void Task::set_include_provider(IncludeProvider* provider)
+{
+    m_provider = provider;
+}
+
+void Task::set_include_once(bool once)
+{
+    m_include_once = once;
+}
+
+void Task::set_include_memo(IncludeMemo* memo)
+{
+    m_memo = memo;
+}
+
+void Task::set_prefetch(IncludePrefetch* prefetch)
+{
+    m_prefetch = prefetch;
+}
+
+void Task::set_include_read(const IncludeRead* read)
+{
+    m_include_read = read;
+}
+
+IncludeRead Task::read_include(const std::string& path) const
+{
+    return read_include(path, *m_context, m_provider, m_files, m_loader, m_decrypt_key, m_stats);
+}
+
+void Task::set_stats(Stats* stats)
+{
+    m_stats = stats;
+}
+
+void Task::set_tracer(Tracer* tracer)
+{
+    m_tracer = tracer;
+}
+
+void Task::reset()
+{
+    m_state        = State::sKeep;
+    m_type         = Type::tOrigin;
+    m_partial      = false;
+    m_branch_stack = {};
+    m_progSource.clear();
+    m_once.clear();
+    m_include_stack.clear();
+    m_effects  = nullptr;
+    m_location = {};
+}
+
+void Task::set_line(uint32_t line)
+{
+    m_location.line = line;
+}
+
+Task::State Task::process_origin(std::string& line)
+{
+    if (m_stats)
+        m_stats->lines++;
+    m_location.line++;
+
+    m_type = Type::tOrigin;
+    _process_origin(line);
+    return m_state;
+}
+
 Task::State Task::process(std::string& line)
 {
+    if (m_stats)
+        m_stats->lines++;
+    m_location.line++;
+    t_diagnostic_target.location = &m_location;
+    check_cancellation();
+
     auto origin_line = line;
     m_type           = _extract_task(line);
 
+    TraceScope trace(m_type == Type::tOrigin ? nullptr : m_tracer, "directive", Stats::name(m_directive));
+
     switch (m_type)
     {
         case Type::tOrigin:
             _process_origin(line);
             break;
         case Type::tMacro:
-            _process_static_branch(line);
+            if (m_partial)
+                _process_partial_branch(origin_line, line);
+            else
+                _process_static_branch(line);
             _process_state();
             break;
         case Type::tInstance:
-            line = _process_dynamic_branch(line);
+            if (m_partial)
+                _process_partial_branch(origin_line, line);
+            else
+                line = _process_dynamic_branch(line);
             _process_state();
             break;
         case Type::tInclude:
@@ -70,16 +188,75 @@ Task::State Task::process(std::string& line)
             _process_override(origin_line, line);
             break;
         case Type::tEmbed:
-            _process_embed(line);
+            _process_embed(origin_line, line);
             break;
         case Type::tProg:
-            _process_prog(line);
+            _process_prog(origin_line, line);
+            break;
+        case Type::tOnce:
+            _process_once(line);
             break;
     }
 
     return m_state;
 }
 
+bool Task::same_state(const Task& other) const
+{
+    return m_state == other.m_state &&
+        m_branch_stack == other.m_branch_stack &&
+        m_progSource == other.m_progSource &&
+        m_once == other.m_once;
+}
+
+bool Task::at_top_level() const
+{
+    return m_state == State::sKeep && m_branch_stack.empty() && m_progSource.empty();
+}
+
+bool Task::has_task(const std::string& line)
+{
+    return std::regex_search(line, g_task);
+}
+
+int Task::branch_delta(const std::string& line)
+{
+    std::smatch match_task;
+    if (!std::regex_search(line, match_task, g_task))
+        return 0;
+
+    auto        task = match_task[1].str();
+    std::smatch match_type;
+    if (!std::regex_search(task, match_type, g_task_static) && !std::regex_search(task, match_type, g_task_dynamic))
+        return 0;
+
+    auto expr = match_type[1].str();
+    if (std::regex_search(expr, g_branch_elif))
+        return 0;
+    if (std::regex_search(expr, g_branch_if))
+        return 1;
+    if (std::regex_search(expr, g_branch_else))
+        return 0;
+
+    // Like _extract_branch_tag, anything else closes the branch
+    return -1;
+}
+
+bool Task::extract_include(const std::string& line, std::string& path)
+{
+    std::smatch match_task;
+    if (!std::regex_search(line, match_task, g_task))
+        return false;
+
+    auto        task = match_task[1].str();
+    std::smatch match_type;
+    if (!std::regex_search(task, match_type, g_task_include))
+        return false;
+
+    path = match_type[1].str();
+    return true;
+}
+
 void Task::_process_origin(std::string& line)
 {
     if (_is_skip())
@@ -169,12 +346,7 @@ DynamicBranch Task::_eval_dynamic_banch(std::string& line)
                 break;
             }
 
-            Lexer          lexer(line);
-            auto           tokens = lexer.tokenize();
-            Parser         parser(tokens);
-            auto           root = parser.parse();
-            ExprSimplifier simplifier(m_context->instances);
-            auto           simplifiedNode = simplifier.simplify(root.get());
+            auto simplifiedNode = _simplify_dynamic_expr(line);
 
             state.current = _is_valid_condition_expr(simplifiedNode.get());
             if (state.current)
@@ -198,12 +370,7 @@ DynamicBranch Task::_eval_dynamic_banch(std::string& line)
             if (!brother.enable_else)
                 state.type = BranchTag::tIf;
 
-            Lexer          lexer(line);
-            auto           tokens = lexer.tokenize();
-            Parser         parser(tokens);
-            auto           root = parser.parse();
-            ExprSimplifier simplifier(m_context->instances);
-            auto           simplifiedNode = simplifier.simplify(root.get());
+            auto simplifiedNode = _simplify_dynamic_expr(line);
 
             state.current = _is_valid_condition_expr(simplifiedNode.get());
             if (state.current)
@@ -278,22 +445,226 @@ std::string Task::_process_dynamic_branch(std::string& line)
     return expr;
 }
 
+// Rewrite the directive of origin with a new body, keeping its keyword and indent
+static std::string replace_task(const std::string& origin, const std::string& body)
+{
+    std::smatch match_task;
+    if (!std::regex_search(origin, match_task, g_task))
+        return origin;
+
+    auto task    = match_task[1].str();
+    auto keyword = task.substr(0, task.find(' '));
+    auto begin   = match_task.position(1);
+    return origin.substr(0, begin) + keyword + " " + body + origin.substr(begin + match_task.length(1));
+}
+
+void Task::_process_partial_branch(const std::string& origin, std::string& line)
+{
+    PartialBranch state;
+    state.type = _extract_branch_tag(line);
+
+    std::string body;
+    switch (state.type)
+    {
+        case BranchTag::tIf:
+        {
+            if (_in_miss_branch())
+            {
+                m_branch_stack.push(state);
+                break;
+            }
+
+            auto truth       = _eval_partial_condition_expr(line);
+            state.current    = truth != Tristate::tFalse;
+            state.choosed_if = truth == Tristate::tTrue;
+            state.residual   = truth == Tristate::tUnknown;
+            if (state.residual)
+                body = "if " + line;
+
+            m_branch_stack.push(state);
+            break;
+        }
+        case BranchTag::tElif:
+        {
+            auto brother = _pop_partial();
+            if (_in_miss_branch())
+            {
+                m_branch_stack.push(state);
+                break;
+            }
+
+            state.residual = brother.residual;
+            if (brother.choosed_if)
+            {
+                state.choosed_if = true;
+                m_branch_stack.push(state);
+                break;
+            }
+
+            auto truth       = _eval_partial_condition_expr(line);
+            state.current    = truth != Tristate::tFalse;
+            state.choosed_if = truth == Tristate::tTrue;
+            if (truth == Tristate::tUnknown)
+            {
+                body           = (brother.residual ? "elif " : "if ") + line;
+                state.residual = true;
+            }
+            else if (truth == Tristate::tTrue && brother.residual)
+            {
+                body = "else";
+            }
+
+            m_branch_stack.push(state);
+            break;
+        }
+        case BranchTag::tElse:
+        {
+            auto brother = _pop_partial();
+            if (_in_miss_branch())
+            {
+                m_branch_stack.push(state);
+                break;
+            }
+
+            state.residual = brother.residual;
+            state.current  = !brother.choosed_if;
+            if (state.current && brother.residual)
+                body = "else";
+
+            m_branch_stack.push(state);
+            break;
+        }
+        case BranchTag::tEndif:
+        {
+            auto brother = _pop_partial();
+            if (brother.residual)
+                body = "endif";
+            break;
+        }
+    }
+
+    line = body.empty() ? "" : replace_task(origin, body);
+}
+
+Tristate Task::_eval_partial_condition_expr(std::string& line)
+{
+    // Dynamic branches are left to the stage that binds the instances
+    if (m_type == Type::tInstance)
+        return Tristate::tUnknown;
+
+    auto root = _parse_expr(line);
+
+    std::unique_ptr<Node> residual;
+    {
+        StageTimer      timer(m_stats, Stage::tSimplify);
+        ExprSpecializer specializer(m_context->bools, m_context->ints, m_context->strings);
+        residual = specializer.specialize(root.get());
+    }
+
+    auto truth = ExprSpecializer::truth(residual.get());
+    if (truth == Tristate::tUnknown)
+    {
+        StageTimer timer(m_stats, Stage::tGenerate);
+        line = ExprSpecializer::to_source(residual.get());
+    }
+
+    return truth;
+}
+
 void Task::_process_include(std::string& path)
 {
     if (_is_skip())
+    {
+        path = "";
+        return;
+    }
+
+    TraceScope trace(m_tracer, "include", path);
+
+    IncludeRead read;
+    {
+        StageTimer timer(m_stats, Stage::tInclude);
+        if (m_include_read)
+        {
+            read           = *m_include_read;
+            m_include_read = nullptr;
+        }
+        else if (m_prefetch)
+        {
+            StageTimer io_timer(m_stats, Stage::tIncludeIO);
+            read = m_prefetch->take(path);
+        }
+        else
+        {
+            read = read_include(path, *m_context, m_provider, m_files, m_loader, m_decrypt_key, m_stats);
+        }
+    }
+    if (!read.content)
+        PPS_ERROR(DiagnosticCode::tIncludeNotFound, "Fail to find include {}.", path);
+    for (const auto& dependency : read.dependencies)
+        _record_dependency(dependency);
+    for (const auto& miss : read.misses)
+        _record_miss(miss);
+
+    // Includes that were not found keep the name they were given
+    auto key = read.dependencies.empty() ? path : read.dependencies.front();
+    if (std::find(m_include_stack.begin(), m_include_stack.end(), key) != m_include_stack.end())
+    {
+        std::string chain;
+        for (const auto& include : m_include_stack)
+            chain += include + " -> ";
+        PPS_ERROR(DiagnosticCode::tIncludeCycle, "Include cycle: {}{}.", chain, key);
+        if (m_effects)
+            m_effects->cycle = true;
+        path = "";
         return;
+    }
 
-    std::string content;
-    content += _extract_include_from_ctx(path);
-    content += _extract_include_from_loader(path);
+    if (_check_once(key))
+    {
+        path = "";
+        return;
+    }
+    if (m_include_once)
+        _add_once(key);
 
-    std::string        out;
-    std::istringstream iss(content);
-    std::string        line;
-    uint32_t           line_number = 0;
-    while (std::getline(iss, line))
+    std::string out;
+    auto        memoize = m_memo && !m_partial;
+    if (memoize && _replay_include(key, out))
     {
-        line_number++;
+        path = out;
+        return;
+    }
+
+    // Capture what the body depends on, then pass it on to an enclosing capture
+    IncludeEffects effects;
+    BranchStack    entry_stack;
+    auto           outer = m_effects;
+    if (memoize)
+    {
+        entry_stack = m_branch_stack;
+        m_effects   = &effects;
+    }
+
+    // Split like std::getline, without copying the shared buffer into a stream first
+    static const std::string empty;
+    const auto&              content = read.content ? *read.content : empty;
+
+    // Diagnostics of the body point into the included file
+    auto location = std::move(m_location);
+    m_location    = {key, 0};
+
+    m_include_stack.push_back(key);
+    std::string line;
+    size_t      offset = 0;
+    while (offset < content.size())
+    {
+        auto end = content.find('\n', offset);
+        if (end == std::string::npos)
+            end = content.size();
+
+        line.assign(content, offset, end - offset);
+        offset = end + 1;
         process(line);
 
         if (line.empty())
@@ -303,22 +674,145 @@ void Task::_process_include(std::string& path)
 
         out += line;
     }
+    m_include_stack.pop_back();
+
+    m_location                   = std::move(location);
+    t_diagnostic_target.location = &m_location;
+
+    if (memoize)
+    {
+        m_effects = outer;
+        _memoize_include(key, std::move(entry_stack), std::move(effects), out);
+    }
 
     path = out;
 }
 
-std::string Task::_extract_include_from_ctx(const std::string& path)
+// Add the effects of a nested include body to the capture of the include around it
+static void merge_effects(IncludeEffects& outer, const IncludeEffects& inner)
 {
-    std::string oldPath = path;
-    for (const auto& prefix : m_context->prefixes)
+    for (const auto& check : inner.once_checks)
     {
-        std::string fullPath = prefix + oldPath;
+        if (std::find(outer.once_added.begin(), outer.once_added.end(), check.first) == outer.once_added.end())
+            outer.once_checks.push_back(check);
+    }
+    outer.reads.insert(outer.reads.end(), inner.reads.begin(), inner.reads.end());
+    outer.dependencies.insert(outer.dependencies.end(), inner.dependencies.begin(), inner.dependencies.end());
+    outer.misses.insert(outer.misses.end(), inner.misses.begin(), inner.misses.end());
+    outer.once_added.insert(outer.once_added.end(), inner.once_added.begin(), inner.once_added.end());
+    outer.cycle = outer.cycle || inner.cycle;
+}
+
+bool Task::_check_once(const std::string& key)
+{
+    auto found = m_once.count(key) != 0;
+
+    // Answers to keys the body added itself do not depend on what came before it
+    if (m_effects && std::find(m_effects->once_added.begin(), m_effects->once_added.end(), key) == m_effects->once_added.end())
+        m_effects->once_checks.emplace_back(key, found);
+    return found;
+}
+
+void Task::_add_once(const std::string& key)
+{
+    if (m_once.insert(key).second && m_effects)
+        m_effects->once_added.push_back(key);
+}
+
+bool Task::_replay_include(const std::string& key, std::string& out)
+{
+    for (const auto& entry : m_memo->find(key))
+    {
+        if (entry->entry_stack != m_branch_stack || entry->decisions != IncludeMemo::decisions(*m_context, entry->reads))
+            continue;
+
+        auto same_once = std::all_of(entry->effects.once_checks.begin(), entry->effects.once_checks.end(),
+                                     [&](const auto& check) { return (m_once.count(check.first) != 0) == check.second; });
+        if (!same_once)
+            continue;
+
+        // Record the effects as if the body had run
+        if (m_reads)
+            m_reads->insert(m_reads->end(), entry->effects.reads.begin(), entry->effects.reads.end());
+        if (m_dependencies)
+            m_dependencies->insert(m_dependencies->end(), entry->effects.dependencies.begin(), entry->effects.dependencies.end());
+        if (m_misses)
+            m_misses->insert(m_misses->end(), entry->effects.misses.begin(), entry->effects.misses.end());
+        if (m_effects)
+            merge_effects(*m_effects, entry->effects);
+        m_once.insert(entry->effects.once_added.begin(), entry->effects.once_added.end());
+
+        m_branch_stack = entry->exit_stack;
+        m_state        = entry->exit_state;
+        out            = entry->output;
+        return true;
+    }
+
+    return false;
+}
+
+void Task::_memoize_include(const std::string& key, BranchStack entry_stack, IncludeEffects effects, const std::string& out)
+{
+    // The enclosing capture depends on everything the body did
+    if (m_effects)
+        merge_effects(*m_effects, effects);
+    if (effects.cycle)
+        return;
+
+    auto entry   = std::make_shared<IncludeMemoEntry>();
+    entry->reads = effects.reads;
+    std::sort(entry->reads.begin(), entry->reads.end());
+    entry->reads.erase(std::unique(entry->reads.begin(), entry->reads.end()), entry->reads.end());
+
+    entry->decisions   = IncludeMemo::decisions(*m_context, entry->reads);
+    entry->entry_stack = std::move(entry_stack);
+    entry->effects     = std::move(effects);
+    entry->output      = out;
+    entry->exit_stack  = m_branch_stack;
+    entry->exit_state  = m_state;
+    m_memo->store(key, std::move(entry));
+}
+
+void Task::_process_once(std::string& line)
+{
+    // Marks the file being included; a pragma in the processed source itself has no effect
+    if (!_is_skip() && !m_include_stack.empty())
+        _add_once(m_include_stack.back());
+    line = "";
+}
+
+static bool read_include_from_ctx(const std::string& path, const Context& context, FileCache* files, Stats* stats, IncludeRead& read)
+{
+    for (const auto& prefix : context.prefixes)
+    {
+        std::string fullPath = prefix + path;
+        StageTimer  timer(stats, Stage::tIncludeIO);
+        if (files)
+        {
+            auto content = files->read(fullPath);
+            if (!content)
+            {
+                read.misses.push_back(std::move(fullPath));
+                continue;
+            }
+
+            read.dependencies.push_back(fullPath);
+            read.content = std::move(content);
+            return true;
+        }
+
         if (!std::filesystem::exists(fullPath))
+        {
+            read.misses.push_back(std::move(fullPath));
             continue;
+        }
 
         std::ifstream includeStream(fullPath, std::ios::binary);
         if (!includeStream)
+        {
+            read.misses.push_back(std::move(fullPath));
             continue;
+        }
 
         includeStream.seekg(0, std::ios::end);
         std::streamsize size = includeStream.tellg();
@@ -327,62 +821,112 @@ std::string Task::_extract_include_from_ctx(const std::string& path)
         std::string content(size, '\0');
         if (includeStream.read(&content[0], size))
         {
-            return std::move(content);
+            read.dependencies.push_back(fullPath);
+            read.content = std::make_shared<const std::string>(std::move(content));
+            return true;
         }
     }
 
-    return "";
+    return false;
 }
 
-std::string Task::_extract_include_from_loader(const std::string& path)
+static bool read_include_from_loader(const std::string& path, sbin::Loader* module_loader, const std::string& decrypt_key, Stats* stats, IncludeRead& read)
 {
-    if (m_loader == nullptr)
+    if (module_loader == nullptr)
+        return false;
+
+    StageTimer timer(stats, Stage::tLoader);
+    auto       data = module_loader->get_shader(path, decrypt_key);
+    if (data == nullptr)
     {
-        ACLG_WARN("Loader is not set.");
-        return "";
+        read.misses.push_back("@loader/" + path);
+        return false;
     }
 
-    auto data = m_loader->get_shader(path, m_decrypt_key);
-    if (data == nullptr)
+    // Found in both places, the loader's content follows the file's
+    auto content = read.content ? *read.content : std::string();
+    content.append(data->data.begin(), data->data.end());
+
+    read.dependencies.push_back("@loader/" + path);
+    read.content = std::make_shared<const std::string>(std::move(content));
+    return true;
+}
+
+IncludeRead Task::read_include(const std::string& path, const Context& context, IncludeProvider* provider, FileCache* files, sbin::Loader* module_loader, const std::string& decrypt_key, Stats* stats)
+{
+    IncludeRead read;
+    if (provider)
     {
-        ACLG_ERROR("Fail to load {} from loader.", path);
-        return "";
+        IncludeFile file;
+        {
+            StageTimer timer(stats, Stage::tIncludeIO);
+            if (!provider->read(path, context.prefixes, file))
+                return read;
+        }
+
+        read.dependencies.push_back(std::move(file.path));
+        read.content = std::move(file.content);
+        return read;
     }
 
-    return std::string(data->data.begin(), data->data.end());
+    read_include_from_ctx(path, context, files, stats, read);
+    read_include_from_loader(path, module_loader, decrypt_key, stats, read);
+    return read;
 }
 
 void Task::_process_override(std::string& origin, std::string& expr)
 {
     if (_is_skip())
+    {
+        expr = "";
         return;
+    }
 
+    _record_read(expr);
     auto iter = m_context->strings.find(expr);
+    if (iter == m_context->strings.end() && m_partial)
+    {
+        expr = origin;
+        return;
+    }
     if (iter == m_context->strings.end())
     {
-        ACLG_ERROR("Fail to find {} in context.", expr);
+        PPS_ERROR(DiagnosticCode::tMissingOverride, "Fail to find {} in context.", expr);
         expr = "";
         return;
     }
 
-    static std::regex token_override_expr(R"((\w+)\s*(/\*<\$override[^>]*>\*/))");
-    expr = std::regex_replace(origin, token_override_expr, iter->second);
+    expr = std::regex_replace(origin, g_override_expr, iter->second);
 }
 
-void Task::_process_embed(std::string& expr)
+void Task::_process_embed(std::string& origin, std::string& expr)
 {
     if (_is_skip())
+    {
+        expr = "";
         return;
+    }
+
+    if (m_partial)
+        expr = origin;
 }
 
-void Task::_process_prog(std::string& expr)
+void Task::_process_prog(std::string& origin, std::string& expr)
 {
     if (_is_skip())
+    {
+        expr = "";
         return;
+    }
+
+    if (m_partial)
+        expr = origin;
 }
 
 Task::Type Task::_extract_task(std::string& line)
 {
+    StageTimer timer(m_stats, Stage::tScan);
+
     std::smatch match_task;
     if (!std::regex_search(line, match_task, g_task))
         return Type::tOrigin;
@@ -392,33 +936,44 @@ Task::Type Task::_extract_task(std::string& line)
     if (std::regex_search(task, match_type, g_task_static))
     {
         line = match_type[1].str();
+        _record_directive(Directive::tStatic);
         return Type::tMacro;
     }
     if (std::regex_search(task, match_type, g_task_dynamic))
     {
         line = match_type[1].str();
+        _record_directive(Directive::tDynamic);
         return m_context->isStatic ? Type::tMacro : Type::tInstance;
     }
     else if (std::regex_search(task, match_type, g_task_include))
     {
         line = match_type[1].str();
+        _record_directive(Directive::tInclude);
         return Type::tInclude;
     }
     else if (std::regex_search(task, match_type, g_task_override))
     {
         line = match_type[1].str();
+        _record_directive(Directive::tOverride);
         return Type::tOverride;
     }
     else if (std::regex_search(task, match_type, g_task_embed))
     {
         line = match_type[0].str();
+        _record_directive(Directive::tEmbed);
         return Type::tEmbed;
     }
     else if (std::regex_search(task, match_type, g_task_prog))
     {
         line = match_type[0].str();
+        _record_directive(Directive::tProg);
         return Type::tProg;
     }
+    else if (std::regex_search(task, g_task_once))
+    {
+        _record_directive(Directive::tPragma);
+        return Type::tOnce;
+    }
 
     return Type::tOrigin;
 }
@@ -450,7 +1005,7 @@ BranchTag Task::_extract_branch_tag(std::string& line)
     return BranchTag::tEndif;
 }
 
-bool Task::_has_branch_true(const std::vector<Token>& tokens)
+bool Task::_has_branch_true(const std::pmr::vector<Token>& tokens)
 {
     for (int i = 0; i < tokens.size(); i++)
     {
@@ -468,27 +1023,52 @@ bool Task::_has_branch_true(const std::vector<Token>& tokens)
 
 bool Task::_is_valid_condition_expr(const Node* node)
 {
-    Evaluator evaluator(&m_context->bools, &m_context->ints, &m_context->strings);
-    auto      value = evaluator.evaluate(node);
+    StageTimer timer(m_stats, Stage::tEvaluate);
+    Evaluator  evaluator(&m_context->bools, &m_context->ints, &m_context->strings);
+    auto       value = evaluator.evaluate(node);
 
     return value->type == ValueType::tBool;
 }
 
 bool Task::_eval_condition_expr(const std::string& line)
 {
-    Lexer lexer(line);
-    auto  tokens = lexer.tokenize();
+    auto root = _parse_expr(line);
 
-    Parser    parser(tokens);
-    auto      root = parser.parse();
-    Evaluator evaluator(&m_context->bools, &m_context->ints, &m_context->strings);
-    auto      value = evaluator.evaluate(root.get());
+    StageTimer timer(m_stats, Stage::tEvaluate);
+    Evaluator  evaluator(&m_context->bools, &m_context->ints, &m_context->strings);
+    auto       value = evaluator.evaluate(root.get());
 
     return std::get<bool>(value->value);
 }
 
+std::unique_ptr<Node> Task::_parse_expr(const std::string& line)
+{
+    // Moved in, not copied, as both vectors use the call's resource
+    std::pmr::vector<Token> tokens(call_resource());
+    {
+        StageTimer timer(m_stats, Stage::tLex);
+        Lexer      lexer(line);
+        tokens = lexer.tokenize();
+    }
+    _record_reads(tokens);
+
+    StageTimer timer(m_stats, Stage::tParse);
+    Parser     parser(tokens);
+    return parser.parse();
+}
+
+std::unique_ptr<Node> Task::_simplify_dynamic_expr(const std::string& line)
+{
+    auto root = _parse_expr(line);
+
+    StageTimer     timer(m_stats, Stage::tSimplify);
+    ExprSimplifier simplifier(m_context->instances);
+    return simplifier.simplify(root.get());
+}
+
 std::string Task::_gen_condition_expr(const Node* node)
 {
+    StageTimer    timer(m_stats, Stage::tGenerate);
     ExprGenerator generator;
     auto          expr = generator.generate(node);
 
@@ -500,6 +1080,49 @@ std::string Task::_gen_condition_expr(const Node* node)
     return expr;
 }
 
+void Task::_record_read(const std::string& name)
+{
+    if (m_reads)
+        m_reads->push_back(name);
+    if (m_effects)
+        m_effects->reads.push_back(name);
+}
+
+void Task::_record_reads(const std::pmr::vector<Token>& tokens)
+{
+    if (!m_reads && !m_effects)
+        return;
+
+    for (const auto& token : tokens)
+    {
+        if (token.type == TokenType::tVariable)
+            _record_read(token.value);
+    }
+}
+
+void Task::_record_dependency(const std::string& path)
+{
+    if (m_dependencies)
+        m_dependencies->push_back(path);
+    if (m_effects)
+        m_effects->dependencies.push_back(path);
+}
+
+void Task::_record_miss(const std::string& path)
+{
+    if (m_misses)
+        m_misses->push_back(path);
+    if (m_effects)
+        m_effects->misses.push_back(path);
+}
+
+void Task::_record_directive(Directive directive)
+{
+    m_directive = directive;
+    if (m_stats)
+        m_stats->directives[size_t(directive)]++;
+}
+
 void Task::_process_state()
 {
     if (m_type == Type::tMacro || m_type == Type::tInstance)
@@ -533,4 +1156,11 @@ DynamicBranch Task::_pop_dynamic()
     return branch;
 }
 
+PartialBranch Task::_pop_partial()
+{
+    auto branch = std::get<PartialBranch>(m_branch_stack.top());
+    m_branch_stack.pop();
+    return branch;
+}
+
 } // namespace pps
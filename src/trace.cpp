@@ -0,0 +1,114 @@
+#include <pps/trace.h>
+#include <stage_timer.h>
+#include <format.h>
+
+#include <aclg/aclg.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace pps
+{
+
+static std::atomic<Tracer*> g_global_tracer = nullptr;
+
+void set_global_tracer(Tracer* tracer)
+{
+    g_global_tracer = tracer;
+}
+
+Tracer* global_tracer()
+{
+    return g_global_tracer;
+}
+
+static uint64_t to_ns(Tracer::Clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+ChromeTracer::ChromeTracer() :
+    m_start(to_ns(Clock::now()))
+{
+}
+
+void ChromeTracer::begin(const char* category, const std::string& name)
+{
+    _record(category, name, true, Clock::now(), std::this_thread::get_id());
+}
+
+void ChromeTracer::end(const char* category)
+{
+    _record(category, "", false, Clock::now(), std::this_thread::get_id());
+}
+
+void ChromeTracer::begin_at(const char* category, const std::string& name, Clock::time_point time, std::thread::id thread)
+{
+    _record(category, name, true, time, thread);
+}
+
+void ChromeTracer::end_at(const char* category, Clock::time_point time, std::thread::id thread)
+{
+    _record(category, "", false, time, thread);
+}
+
+std::string ChromeTracer::to_json()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::string out = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (size_t i = 0; i < m_events.size(); i++)
+    {
+        const auto& event = m_events[i];
+
+        char fields[96];
+        std::snprintf(fields, sizeof(fields), "\"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u", event.begin ? 'B' : 'E', event.timestamp, event.thread);
+
+        out += i ? ",\n{" : "\n{";
+        if (event.begin)
+        {
+            out += "\"name\": ";
+            append_json_string(out, event.name);
+            out += ", ";
+        }
+        out += "\"cat\": \"";
+        out += event.category;
+        out += "\", ";
+        out += fields;
+        out += "}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool ChromeTracer::write(const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        ACLG_ERROR("Could not open trace file {}.", path);
+        return false;
+    }
+
+    file << to_json();
+    return bool(file);
+}
+
+void ChromeTracer::_record(const char* category, const std::string& name, bool begin, Clock::time_point time, std::thread::id thread)
+{
+    // Signed, an event replayed from before the tracer was created lands at a negative time
+    auto timestamp = double(int64_t(to_ns(time) - m_start)) / 1000.0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto iter = std::find(m_threads.begin(), m_threads.end(), thread);
+    if (iter == m_threads.end())
+        iter = m_threads.insert(m_threads.end(), thread);
+
+    m_events.push_back({category, name, timestamp, uint32_t(iter - m_threads.begin()) + 1, begin});
+}
+
+} // namespace pps
@@ -0,0 +1,317 @@
+#include "manifest.h"
+#include "options.h"
+
+#include <pps/archive.h>
+#include <pps/cancel.h>
+#include <pps/engine.h>
+#include <pps/file_cache.h>
+#include <varint.h>
+
+#include <aclg/aclg.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// Binary manifest: "PPSM", version, varint count, then per entry the
+// varint-prefixed output path and varint-prefixed pps::Context::serialize() blob
+static const std::string g_binary_magic   = "PPSM";
+static const uint8_t     g_binary_version = 1;
+
+template <typename Map>
+static void mergeVariables(Map& target, Map& source)
+{
+    for (auto& [key, value] : source)
+        target[key] = std::move(value);
+}
+
+static bool readBinaryManifest(std::string_view data, const pps::Context& base, bool baseMode, std::vector<ManifestEntry>& entries)
+{
+    data.remove_prefix(g_binary_magic.size());
+    if (data.empty() || uint8_t(data.front()) != g_binary_version)
+    {
+        ACLG_ERROR("Unsupported binary manifest version.");
+        return false;
+    }
+    data.remove_prefix(1);
+
+    uint64_t count;
+    if (!pps::read_varint(data, count))
+        return false;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        std::string_view output;
+        std::string_view blob;
+        pps::Context     variables;
+        if (!pps::read_blob(data, output) || !pps::read_blob(data, blob) || !variables.deserialize(blob))
+        {
+            ACLG_ERROR("Malformed binary manifest entry {}.", i);
+            return false;
+        }
+
+        // The entry's variables win over the command line's, as in text manifests. A serialized
+        // context always holds a mode, so it only applies when --static/--dynamic was not given.
+        ManifestEntry entry;
+        entry.output  = output;
+        entry.context = base;
+        if (!baseMode)
+            entry.context.isStatic = variables.isStatic;
+        mergeVariables(entry.context.bools, variables.bools);
+        mergeVariables(entry.context.ints, variables.ints);
+        mergeVariables(entry.context.strings, variables.strings);
+        mergeVariables(entry.context.instances, variables.instances);
+        entry.context.prefixes.insert(variables.prefixes.begin(), variables.prefixes.end());
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+// Split a line on spaces; double quotes group a value that contains spaces
+static std::vector<std::string> splitManifestLine(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::string              token;
+    bool                     quoted  = false;
+    bool                     pending = false;
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        char c = line[i];
+        if (c == '"')
+        {
+            quoted  = !quoted;
+            pending = true;
+        }
+        else if (c == '\\' && quoted && i + 1 < line.size())
+        {
+            token += line[++i];
+        }
+        else if ((c == ' ' || c == '\t' || c == '\r') && !quoted)
+        {
+            if (pending)
+                tokens.push_back(std::move(token));
+            token.clear();
+            pending = false;
+        }
+        else
+        {
+            token += c;
+            pending = true;
+        }
+    }
+    if (pending)
+        tokens.push_back(std::move(token));
+
+    return tokens;
+}
+
+// Text manifest: one entry per line, the output path followed by the same
+// context options as the command line. The path can be left out when writing
+// an archive. Empty lines and '#' comments are skipped.
+static bool readTextManifest(const std::string& data, const pps::Context& base, std::vector<ManifestEntry>& entries)
+{
+    std::istringstream iss(data);
+    std::string        line;
+    uint32_t           line_number = 0;
+    while (std::getline(iss, line))
+    {
+        line_number++;
+
+        auto tokens = splitManifestLine(line);
+        if (tokens.empty() || tokens[0][0] == '#')
+            continue;
+
+        ManifestEntry entry;
+        size_t        first = tokens[0].rfind("--", 0) == 0 ? 0 : 1;
+        entry.output        = first ? tokens[0] : "";
+        entry.context       = base;
+        for (size_t i = first; i < tokens.size(); i++)
+        {
+            const auto& flag = tokens[i];
+            if (flag == "--static" || flag == "--dynamic")
+            {
+                entry.context.isStatic = (flag == "--static");
+            }
+            else if (isContextOption(flag) && i + 1 < tokens.size())
+            {
+                if (!applyContextOption(flag, tokens[++i], entry.context))
+                    return false;
+            }
+            else
+            {
+                ACLG_ERROR("Unknown manifest option {} at line {}.", flag, line_number);
+                return false;
+            }
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+bool readManifest(const std::string& path, const pps::Context& base, bool baseMode, std::vector<ManifestEntry>& entries)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        ACLG_ERROR("Could not open manifest {}.", path);
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string data = buffer.str();
+
+    if (data.rfind(g_binary_magic, 0) == 0)
+        return readBinaryManifest(data, base, baseMode, entries);
+
+    return readTextManifest(data, base, entries);
+}
+
+static bool writeOutput(const std::string& path, const std::string& result)
+{
+    std::error_code ec;
+    auto            parent = fs::path(path).parent_path();
+    if (!parent.empty())
+        fs::create_directories(parent, ec);
+
+    std::ofstream outFile(path, std::ios::binary);
+    if (!outFile.is_open())
+    {
+        ACLG_ERROR("Could not open output file {}.", path);
+        return false;
+    }
+    outFile << result;
+    return bool(outFile);
+}
+
+int runManifest(const std::string&                inputPath,
+                const std::string&                source,
+                const std::vector<ManifestEntry>& entries,
+                const BatchOptions&               options)
+{
+    pps::FileCache     files;
+    pps::ArchiveWriter archive;
+    pps::Engine        engine;
+    engine.set_file_cache(&files);
+    engine.set_cache(options.cache);
+    if (!options.archivePath.empty() && !archive.open(options.archivePath))
+        return 1;
+
+    // With an archive, one depfile covers the includes of every entry
+    std::mutex            dependencyMutex;
+    std::set<std::string> dependencies;
+
+    std::atomic<size_t> next     = 0;
+    std::atomic<size_t> failed   = 0;
+    std::atomic<size_t> timedOut = 0;
+
+    // Every entry shares the source, so it is scanned for directives once
+    auto prepared = engine.prepare(source);
+
+    // Workers share the engine and its caches, each owns a session
+    auto worker = [&]() {
+        pps::Session processor(engine);
+
+        for (size_t index = next++; index < entries.size(); index = next++)
+        {
+            const auto& entry   = entries[index];
+            auto        context = entry.context;
+
+            pps::CancellationToken deadline{std::chrono::milliseconds(options.timeout)};
+            processor.set_cancellation(options.timeout ? &deadline : nullptr);
+
+            std::string result;
+            try
+            {
+                result = processor.process(*prepared, &context);
+            }
+            catch (const pps::Cancelled&)
+            {
+                ACLG_ERROR("Manifest entry {} timed out after {} ms.", index, options.timeout);
+                timedOut++;
+                failed++;
+                continue;
+            }
+            catch (const std::exception& e)
+            {
+                // Entries are independent, one that fails leaves the others to finish
+                ACLG_ERROR("Manifest entry {} failed: {}", index, e.what());
+                failed++;
+                continue;
+            }
+
+            if (!options.archivePath.empty())
+            {
+                if (!archive.add(entry.context, result))
+                    failed++;
+
+                if (options.writeDeps)
+                {
+                    std::lock_guard<std::mutex> lock(dependencyMutex);
+                    dependencies.insert(processor.dependencies().begin(), processor.dependencies().end());
+                }
+                continue;
+            }
+
+            if (entry.output.empty())
+            {
+                ACLG_ERROR("Manifest entry {} has no output path.", index);
+                failed++;
+                continue;
+            }
+
+            if (!writeOutput(entry.output, result))
+            {
+                failed++;
+                continue;
+            }
+
+            if (options.writeDeps && !writeDepfile(entry.output + ".d", entry.output, inputPath, processor.dependencies(), options.phonyDeps))
+                failed++;
+        }
+    };
+
+    auto jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs      = std::min<size_t>(jobs, std::max<size_t>(1, entries.size()));
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < jobs; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    ACLG_INFO("Processed {} permutations with {} workers, {} failed, {} timed out.", entries.size(), jobs, size_t(failed), size_t(timedOut));
+
+    if (!options.archivePath.empty())
+    {
+        ACLG_INFO("Archive: {} entries, {} duplicate outputs stored once.", archive.size(), archive.duplicates());
+        if (!archive.finish())
+        {
+            ACLG_ERROR("Fail to write archive {}.", options.archivePath);
+            return 1;
+        }
+
+        std::vector<std::string> paths(dependencies.begin(), dependencies.end());
+
+        auto target  = options.depTarget.empty() ? options.archivePath : options.depTarget;
+        auto depPath = options.depPath.empty() ? options.archivePath + ".d" : options.depPath;
+        if (options.writeDeps && !writeDepfile(depPath, target, inputPath, paths, options.phonyDeps))
+            return 1;
+    }
+
+    if (timedOut)
+        return 2;
+    return failed == 0 ? 0 : 1;
+}
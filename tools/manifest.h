@@ -0,0 +1,38 @@
+#pragma once
+
+#include <pps/pps.h>
+#include <pps/cache.h>
+
+#include <string>
+#include <vector>
+
+// One permutation of a manifest: where to write it and its context
+struct ManifestEntry
+{
+    std::string  output;
+    pps::Context context;
+};
+
+struct BatchOptions
+{
+    unsigned    jobs      = 0;
+    pps::Cache* cache     = nullptr;
+    std::string archivePath;
+    bool        writeDeps = false;
+    bool        phonyDeps = false;
+    unsigned    timeout   = 0; // Milliseconds per entry, 0 for none
+    std::string depPath;   // Depfile of the archive, default <archive>.d
+    std::string depTarget; // Target named in it, default the archive
+};
+
+// Read a text or binary manifest; every entry starts from the `base` context. Binary entries
+// always carry a mode, which replaces the base's unless `baseMode` was given on the command line.
+bool readManifest(const std::string& path, const pps::Context& base, bool baseMode, std::vector<ManifestEntry>& entries);
+
+// Process every entry of a manifest in one process with shared file caches.
+// Outputs go to the path of each entry, or all into one archive when `archivePath` is set.
+// Returns 2 when an entry timed out, 1 when one failed otherwise.
+int runManifest(const std::string&                inputPath,
+                const std::string&                source,
+                const std::vector<ManifestEntry>& entries,
+                const BatchOptions&               options);
@@ -0,0 +1,146 @@
+#include "options.h"
+
+#include <aclg/aclg.h>
+
+#include <algorithm>
+#include <fstream>
+
+bool isContextOption(const std::string& flag)
+{
+    return flag == "--db" || flag == "--di" || flag == "--ds" || flag == "--r" || flag == "--i";
+}
+
+bool applyContextOption(const std::string& flag, const std::string& value, pps::Context& ctx)
+{
+    // Database option
+    if (flag == "--db")
+    {
+        std::string dbOption = value;
+        // Parse dbOption as key=value and add to Context
+        size_t pos = dbOption.find('=');
+        if (pos != std::string::npos)
+        {
+            std::string key = dbOption.substr(0, pos);
+            std::string val = dbOption.substr(pos + 1);
+            // Parse as boolean
+            if (val == "true" || val == "false")
+            {
+                ctx.bools[key] = (val == "true");
+            }
+            else
+            {
+                // If not explicitly true/false, treat as true if value is non-empty
+                ctx.bools[key] = !val.empty();
+            }
+        }
+    }
+    // Diagnostic option
+    else if (flag == "--di")
+    {
+        std::string diOption = value;
+        // Parse diOption as key=value and add to Context
+        size_t pos = diOption.find('=');
+        if (pos != std::string::npos)
+        {
+            std::string key = diOption.substr(0, pos);
+            std::string val = diOption.substr(pos + 1);
+            // Try to parse as integer
+            try
+            {
+                int intValue  = std::stoi(val);
+                ctx.ints[key] = intValue;
+            }
+            catch (...)
+            {
+                ACLG_ERROR("Invalid integer value for --di option.");
+                return false;
+            }
+        }
+    }
+    // Data source option
+    else if (flag == "--ds")
+    {
+        std::string dsOption = value;
+        // Parse dsOption as key=value and add to Context
+        size_t pos = dsOption.find('=');
+        if (pos != std::string::npos)
+        {
+            std::string key  = dsOption.substr(0, pos);
+            std::string val  = dsOption.substr(pos + 1);
+            ctx.strings[key] = val;
+        }
+    }
+    // Rule option
+    else if (flag == "--r")
+    {
+        std::string rOption = value;
+        // Parse rOption as key=value and add to Context
+        size_t pos = rOption.find('=');
+        if (pos != std::string::npos)
+        {
+            std::string key    = rOption.substr(0, pos);
+            std::string val    = rOption.substr(pos + 1);
+            ctx.instances[key] = val;
+        }
+    }
+    // Include path option
+    else if (flag == "--i")
+    {
+        std::string includePath = value;
+        ctx.prefixes.insert(includePath);
+    }
+
+    return true;
+}
+
+// Escape a path for Makefile/Ninja depfiles
+static std::string escapeDepPath(const std::string& path)
+{
+    std::string escaped;
+    for (char c : path)
+    {
+        if (c == ' ' || c == '#')
+            escaped += '\\';
+        else if (c == '$')
+            escaped += '$';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool writeDepfile(const std::string&              depPath,
+                  const std::string&              target,
+                  const std::string&              inputPath,
+                  const std::vector<std::string>& dependencies,
+                  bool                            phony)
+{
+    std::ofstream depFile(depPath);
+    if (!depFile.is_open())
+    {
+        ACLG_ERROR("Could not open depfile {}.", depPath);
+        return false;
+    }
+
+    std::vector<std::string> paths;
+    for (const auto& dependency : dependencies)
+    {
+        if (std::find(paths.begin(), paths.end(), dependency) == paths.end())
+            paths.push_back(dependency);
+    }
+
+    depFile << escapeDepPath(target) << ": " << escapeDepPath(inputPath);
+    for (const auto& path : paths)
+        depFile << " \\\n  " << escapeDepPath(path);
+    depFile << "\n";
+
+    // "@loader/" and "@memory/" paths are no files make could find; their empty rules are
+    // always out of date, so the target is rebuilt rather than make failing on them
+    for (const auto& path : paths)
+    {
+        if (phony || path.rfind('@', 0) == 0)
+            depFile << "\n"
+                    << escapeDepPath(path) << ":\n";
+    }
+
+    return true;
+}
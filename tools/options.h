@@ -0,0 +1,20 @@
+#pragma once
+
+#include <pps/pps.h>
+
+#include <string>
+#include <vector>
+
+// Whether `flag` sets a context variable or include path and takes a value
+bool isContextOption(const std::string& flag);
+
+// Apply a context option such as `--db @useShadow=true`; false if the value is invalid
+bool applyContextOption(const std::string& flag, const std::string& value, pps::Context& ctx);
+
+// Write the included files of one output as a Makefile/Ninja compatible depfile;
+// "@loader/" and "@memory/" dependencies are listed as virtual paths with an empty rule
+bool writeDepfile(const std::string&              depPath,
+                  const std::string&              target,
+                  const std::string&              inputPath,
+                  const std::vector<std::string>& dependencies,
+                  bool                            phony);
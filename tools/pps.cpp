@@ -1,4 +1,12 @@
 #include <pps/pps.h>
+#include <pps/cache.h>
+#include <pps/cancel.h>
+#include <pps/stats.h>
+#include <pps/trace.h>
+
+#include "manifest.h"
+#include "options.h"
+#include "serve.h"
 
 #include <aclg/aclg.h>
 
@@ -8,6 +16,8 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <memory>
 
 namespace fs = std::filesystem;
 
@@ -15,7 +25,8 @@ enum class Mode
 {
     Help,
     Codegen,
-    Evaluate
+    Evaluate,
+    Serve
 };
 
 // Function to display usage information for HLSL processing
@@ -25,6 +36,7 @@ void showUsage()
               << "Tasks:\n"
               << "  --codegen            Code generation (default)\n"
               << "  --evaluate           Evaluation\n"
+              << "  --serve              Answer requests on stdin/stdout (or --socket) with warm caches\n"
               << "  --help               Show this help message\n"
               << "Modes:\n"
               << "  --static             Static mode (default)\n"
@@ -36,20 +48,98 @@ void showUsage()
               << "  --instance <xx=xxx>  Define instance context\n"
               << "  --include <path>     Add include path\n"
               << "  --input <path>       Specify input HLSL file\n"
-              << "  --output <path>      Specify output file" << std::endl;
+              << "  --output <path>      Specify output file\n"
+              << "  --MD                 Write a depfile next to the output (<output>.d)\n"
+              << "  --MF <path>          Write the depfile to <path>\n"
+              << "  --MT <target>        Target named in the depfile (default: output file)\n"
+              << "  --MP                 Add a phony target for each dependency\n"
+              << "  --cache <dir>        Reuse outputs stored in the cache directory\n"
+              << "  --cache-size <MB>    Maximum size of the cache directory (default 1024)\n"
+              << "  --manifest <file>    Write one output per manifest entry in a single run\n"
+              << "  --archive <path>     Write the --manifest outputs into one indexed archive\n"
+              << "  --jobs <N>           Worker threads for --manifest (default: hardware threads)\n"
+              << "  --timeout <ms>       Abort processing (each --manifest entry) after <ms>; exits with 2\n"
+              << "  --socket <path>      Unix socket used by --serve\n"
+              << "  --stats <path>       Write stage timings and counters as JSON ('-' for stdout)\n"
+              << "  --trace <path>       Write a Chrome/Perfetto trace of the run" << std::endl;
 }
 
+// Writes the stats and trace of every PPS instance when main returns
+struct Reports
+{
+    std::string       statsPath;
+    pps::Stats        stats;
+    std::string       tracePath;
+    pps::ChromeTracer tracer;
+
+    void attach()
+    {
+        if (!statsPath.empty())
+            pps::set_global_stats(&stats);
+        if (!tracePath.empty())
+            pps::set_global_tracer(&tracer);
+    }
+
+    ~Reports()
+    {
+        pps::set_global_stats(nullptr);
+        pps::set_global_tracer(nullptr);
+
+        if (!tracePath.empty())
+            tracer.write(tracePath);
+
+        if (statsPath.empty())
+            return;
+
+        if (statsPath == "-")
+        {
+            std::cout << stats.to_json() << std::endl;
+            return;
+        }
+
+        std::ofstream file(statsPath);
+        if (!file.is_open())
+        {
+            ACLG_ERROR("Could not open stats file {}.", statsPath);
+            return;
+        }
+        file << stats.to_json() << std::endl;
+    }
+};
+
 int main(int argc, char* argv[])
 {
     Mode mode     = Mode::Codegen;
     bool isStatic = true;
 
-    // Contexts for PPS processing
+    // Contexts for PPS processing; modeGiven when --static or --dynamic was passed
     pps::Context ctx;
+    bool         modeGiven = false;
 
     std::string inputSource;
     std::string outputPath;
 
+    // Depfile options
+    bool        writeDeps = false;
+    bool        phonyDeps = false;
+    std::string depPath;
+    std::string depTarget;
+
+    // Output cache options
+    std::string cacheDir;
+    uint64_t    cacheSize = 1024;
+
+    // Batch options
+    std::string manifestPath;
+    std::string archivePath;
+    unsigned    jobs    = 0;
+    unsigned    timeout = 0;
+
+    // Server options
+    std::string socketPath;
+
+    Reports reports;
+
     // Parse command line arguments
     for (int i = 1; i < argc; i++)
     {
@@ -69,97 +159,113 @@ int main(int argc, char* argv[])
         {
             mode = Mode::Evaluate;
         }
+        else if (arg == "--serve")
+        {
+            mode = Mode::Serve;
+        }
         // Mode options
         else if (arg == "--static" || arg == "--dynamic")
         {
             ctx.isStatic = (arg == "--static");
+            modeGiven    = true;
         }
-        // Database option
-        else if (arg == "--db" && i + 1 < argc)
+        // Context options
+        else if (isContextOption(arg) && i + 1 < argc)
         {
-            std::string dbOption = argv[++i];
-            // Parse dbOption as key=value and add to Context
-            size_t pos = dbOption.find('=');
-            if (pos != std::string::npos)
-            {
-                std::string key   = dbOption.substr(0, pos);
-                std::string value = dbOption.substr(pos + 1);
-                // Parse as boolean
-                if (value == "true" || value == "false")
-                {
-                    ctx.bools[key] = (value == "true");
-                }
-                else
-                {
-                    // If not explicitly true/false, treat as true if value is non-empty
-                    ctx.bools[key] = !value.empty();
-                }
-            }
+            if (!applyContextOption(arg, argv[++i], ctx))
+                return 1;
+        }
+        // Input file option
+        else if (arg == "--input" && i + 1 < argc)
+        {
+            inputSource = argv[++i];
+        }
+        // Output file option
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        // Depfile options
+        else if (arg == "--MD")
+        {
+            writeDeps = true;
         }
-        // Diagnostic option
-        else if (arg == "--di" && i + 1 < argc)
+        else if (arg == "--MF" && i + 1 < argc)
         {
-            std::string diOption = argv[++i];
-            // Parse diOption as key=value and add to Context
-            size_t pos = diOption.find('=');
-            if (pos != std::string::npos)
+            writeDeps = true;
+            depPath   = argv[++i];
+        }
+        else if (arg == "--MT" && i + 1 < argc)
+        {
+            depTarget = argv[++i];
+        }
+        else if (arg == "--MP")
+        {
+            phonyDeps = true;
+        }
+        // Output cache options
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            cacheDir = argv[++i];
+        }
+        else if (arg == "--cache-size" && i + 1 < argc)
+        {
+            try
             {
-                std::string key   = diOption.substr(0, pos);
-                std::string value = diOption.substr(pos + 1);
-                // Try to parse as integer
-                try
-                {
-                    int intValue  = std::stoi(value);
-                    ctx.ints[key] = intValue;
-                }
-                catch (...)
-                {
-                    ACLG_ERROR("Invalid integer value for --di option.");
-                    return 1;
-                }
+                cacheSize = std::stoull(argv[++i]);
+            }
+            catch (...)
+            {
+                ACLG_ERROR("Invalid size for --cache-size option.");
+                return 1;
             }
         }
-        // Data source option
-        else if (arg == "--ds" && i + 1 < argc)
+        // Batch options
+        else if (arg == "--manifest" && i + 1 < argc)
         {
-            std::string dsOption = argv[++i];
-            // Parse dsOption as key=value and add to Context
-            size_t pos = dsOption.find('=');
-            if (pos != std::string::npos)
+            manifestPath = argv[++i];
+        }
+        else if (arg == "--archive" && i + 1 < argc)
+        {
+            archivePath = argv[++i];
+        }
+        else if (arg == "--jobs" && i + 1 < argc)
+        {
+            try
             {
-                std::string key   = dsOption.substr(0, pos);
-                std::string value = dsOption.substr(pos + 1);
-                ctx.strings[key]  = value;
+                jobs = std::stoul(argv[++i]);
+            }
+            catch (...)
+            {
+                ACLG_ERROR("Invalid count for --jobs option.");
+                return 1;
             }
         }
-        // Rule option
-        else if (arg == "--r" && i + 1 < argc)
+        else if (arg == "--timeout" && i + 1 < argc)
         {
-            std::string rOption = argv[++i];
-            // Parse rOption as key=value and add to Context
-            size_t pos = rOption.find('=');
-            if (pos != std::string::npos)
+            try
             {
-                std::string key    = rOption.substr(0, pos);
-                std::string value  = rOption.substr(pos + 1);
-                ctx.instances[key] = value;
+                timeout = std::stoul(argv[++i]);
+            }
+            catch (...)
+            {
+                ACLG_ERROR("Invalid milliseconds for --timeout option.");
+                return 1;
             }
         }
-        // Include path option
-        else if (arg == "--i" && i + 1 < argc)
+        // Server options
+        else if (arg == "--socket" && i + 1 < argc)
         {
-            std::string includePath = argv[++i];
-            ctx.prefixes.insert(includePath);
+            socketPath = argv[++i];
         }
-        // Input file option
-        else if (arg == "--input" && i + 1 < argc)
+        // Report options
+        else if (arg == "--stats" && i + 1 < argc)
         {
-            inputSource = argv[++i];
+            reports.statsPath = argv[++i];
         }
-        // Output file option
-        else if (arg == "--output" && i + 1 < argc)
+        else if (arg == "--trace" && i + 1 < argc)
         {
-            outputPath = argv[++i];
+            reports.tracePath = argv[++i];
         }
         // Input file (assumed to be the last argument if not prefixed)
         else if (arg.substr(0, 2) != "--")
@@ -168,11 +274,22 @@ int main(int argc, char* argv[])
         }
     }
 
+    reports.attach();
+
     switch (mode)
     {
         case Mode::Help:
             showUsage();
             return 0;
+        case Mode::Serve:
+        {
+            // Sources come with each request, the command line only sets shared options
+            std::unique_ptr<pps::Cache> cache;
+            if (!cacheDir.empty())
+                cache = std::make_unique<pps::Cache>(cacheDir, cacheSize << 20);
+
+            return runServer({socketPath, ctx, cache.get()});
+        }
         // (TODO:)Evaluation task prog; need do grammar check
         case Mode::Evaluate:
 
@@ -183,6 +300,13 @@ int main(int argc, char* argv[])
             pps::PPS    processor;
             std::string result;
 
+            std::unique_ptr<pps::Cache> cache;
+            if (!cacheDir.empty())
+            {
+                cache = std::make_unique<pps::Cache>(cacheDir, cacheSize << 20);
+                processor.set_cache(cache.get());
+            }
+
             // Check if we have an input source
             if (inputSource.empty())
             {
@@ -204,17 +328,55 @@ int main(int argc, char* argv[])
             std::string sourceCode = buffer.str();
             file.close();
 
-            if (mode == Mode::Codegen)
+            // Every permutation of the manifest shares the source and the include reads.
+            // Without a manifest, an archive holds the single context of the command line.
+            if (!manifestPath.empty() || !archivePath.empty())
+            {
+                // One output per entry gets one <output>.d each; --MF and --MT name a single depfile
+                if (archivePath.empty() && (!depPath.empty() || !depTarget.empty()))
+                {
+                    ACLG_ERROR("--MF and --MT need --archive with --manifest; each output gets <output>.d otherwise.");
+                    return 1;
+                }
+
+                std::vector<ManifestEntry> entries;
+                if (manifestPath.empty())
+                    entries.push_back({"", ctx});
+                else if (!readManifest(manifestPath, ctx, modeGiven, entries))
+                    return 1;
+
+                int status = runManifest(inputSource, sourceCode, entries, {jobs, cache.get(), archivePath, writeDeps, phonyDeps, timeout, depPath, depTarget});
+                if (cache)
+                {
+                    auto stats = cache->stats();
+                    ACLG_INFO("Cache: {} hits, {} misses, {} stores, {} evictions.", stats.hits, stats.misses, stats.stores, stats.evictions);
+                }
+                return status;
+            }
+
+            pps::CancellationToken deadline{std::chrono::milliseconds(timeout)};
+            if (timeout)
+                processor.set_cancellation(&deadline);
+
+            try
             {
-                // Code generation task
-                result = processor.process(sourceCode, &ctx);
+                if (mode == Mode::Codegen)
+                {
+                    // Code generation task
+                    result = processor.process(sourceCode, &ctx);
+                }
+                else if (mode == Mode::Evaluate)
+                {
+                    // Evaluation task
+                    // For now, we'll just process the source code as with codegen
+                    // but this could be extended to do specific evaluation tasks
+                    result = processor.process(sourceCode, &ctx);
+                }
             }
-            else if (mode == Mode::Evaluate)
+            catch (const pps::Cancelled&)
             {
-                // Evaluation task
-                // For now, we'll just process the source code as with codegen
-                // but this could be extended to do specific evaluation tasks
-                result = processor.process(sourceCode, &ctx);
+                ACLG_ERROR("Processing {} timed out after {} ms.", inputSource, timeout);
+                return 2;
             }
 
             // Output result to file or stdout
@@ -235,6 +397,21 @@ int main(int argc, char* argv[])
                 ACLG_INFO("Succeed: {}", result);
             }
 
+            if (cache)
+            {
+                auto stats = cache->stats();
+                ACLG_INFO("Cache: {} hits, {} misses, {} stores, {} evictions.", stats.hits, stats.misses, stats.stores, stats.evictions);
+            }
+
+            // Dependencies are collected while processing, no second pass
+            if (writeDeps)
+            {
+                auto target = depTarget.empty() ? (outputPath.empty() ? inputSource : outputPath) : depTarget;
+                auto path   = depPath.empty() ? target + ".d" : depPath;
+                if (!writeDepfile(path, target, inputSource, processor.dependencies(), phonyDeps))
+                    return 1;
+            }
+
             return 0;
         }
     }
@@ -0,0 +1,455 @@
+#include "serve.h"
+
+#include <pps/engine.h>
+#include <pps/file_cache.h>
+#include <hash.h>
+#include <varint.h>
+
+#include <aclg/aclg.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static const uint8_t  g_protocol_version = 1;
+static const uint32_t g_max_frame_size   = 1u << 30;
+
+using MemoKey = std::pair<uint64_t, uint64_t>;
+
+struct MemoKeyHash
+{
+    size_t operator()(const MemoKey& key) const { return key.first ^ key.second; }
+};
+
+static MemoKey memoKey(std::string_view source, std::string_view context = {})
+{
+    return {pps::Hasher(1).update(source).update(context).digest(), pps::Hasher(2).update(source).update(context).digest()};
+}
+
+// Prepared templates of previous sources, so that repeated sources are only split into lines once
+class TemplateMemo
+{
+    using Entries = std::list<std::pair<MemoKey, std::shared_ptr<const pps::Template>>>;
+
+    std::mutex                                                  m_mutex;
+    Entries                                                     m_entries;
+    std::unordered_map<MemoKey, Entries::iterator, MemoKeyHash> m_index;
+    uint64_t                                                    m_bytes = 0;
+    uint64_t                                                    m_max_bytes;
+
+public:
+    explicit TemplateMemo(uint64_t max_bytes) :
+        m_max_bytes(max_bytes) {}
+
+    std::shared_ptr<const pps::Template> get(std::string_view source, const pps::Engine& engine)
+    {
+        auto key = memoKey(source);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto iter = m_index.find(key);
+            if (iter != m_index.end() && iter->second->second->source() == source)
+            {
+                m_entries.splice(m_entries.begin(), m_entries, iter->second);
+                return iter->second->second;
+            }
+        }
+
+        // Splitting a large source takes a while, other requests need not wait for it
+        auto prepared = engine.prepare(std::string(source));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto iter = m_index.find(key);
+        if (iter != m_index.end())
+            _erase(iter->second);
+
+        m_bytes += prepared->source().size();
+        m_entries.emplace_front(key, prepared);
+        m_index[key] = m_entries.begin();
+
+        while (m_bytes > m_max_bytes && !m_entries.empty())
+            _erase(std::prev(m_entries.end()));
+        return prepared;
+    }
+
+private:
+    void _erase(Entries::iterator iter)
+    {
+        m_bytes -= iter->second->source().size();
+        m_index.erase(iter->first);
+        m_entries.erase(iter);
+    }
+};
+
+// Outputs of previous requests. An entry is reused while every file it
+// included still has the content it was produced from, and no include
+// candidate it probed and missed has appeared since.
+class OutputMemo
+{
+    struct Entry
+    {
+        std::string                                     context;
+        std::string                                     output;
+        std::vector<std::string>                        dependencies;
+        std::vector<std::shared_ptr<const std::string>> contents;
+        std::vector<std::string>                        misses;
+    };
+
+    using Key     = MemoKey;
+    using Entries = std::list<std::pair<Key, Entry>>;
+
+    std::mutex                                              m_mutex;
+    Entries                                                 m_entries;
+    std::unordered_map<Key, Entries::iterator, MemoKeyHash> m_index;
+    uint64_t                                                m_bytes = 0;
+    uint64_t                                                m_max_bytes;
+
+public:
+    explicit OutputMemo(uint64_t max_bytes) :
+        m_max_bytes(max_bytes) {}
+
+    static Key key(std::string_view source, std::string_view context)
+    {
+        return memoKey(source, context);
+    }
+
+    bool lookup(const Key& key, std::string_view context, pps::FileCache& files, std::string& output, std::vector<std::string>& dependencies)
+    {
+        std::vector<std::shared_ptr<const std::string>> contents;
+        std::vector<std::string>                        misses;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto iter = m_index.find(key);
+            if (iter == m_index.end() || iter->second->second.context != context)
+                return false;
+
+            auto& entry  = iter->second->second;
+            output       = entry.output;
+            dependencies = entry.dependencies;
+            contents     = entry.contents;
+            misses       = entry.misses;
+        }
+
+        // The files are checked without the lock, which other connections need meanwhile
+        bool fresh = true;
+        for (size_t i = 0; i < dependencies.size() && fresh; i++)
+            fresh = files.read(dependencies[i]) == contents[i];
+        for (size_t i = 0; i < misses.size() && fresh; i++)
+            fresh = files.read(misses[i]) == nullptr;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The entry may have been replaced or evicted while the lock was released
+        auto iter = m_index.find(key);
+        if (iter != m_index.end() && iter->second->second.contents == contents)
+        {
+            if (fresh)
+                m_entries.splice(m_entries.begin(), m_entries, iter->second);
+            else
+                _erase(iter->second);
+        }
+        return fresh;
+    }
+
+    void store(const Key& key, std::string_view context, pps::FileCache& files, const std::string& output, const std::vector<std::string>& dependencies, const std::vector<std::string>& misses)
+    {
+        Entry entry = {std::string(context), output, dependencies, {}, misses};
+        for (const auto& path : dependencies)
+            entry.contents.push_back(files.read(path));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto iter = m_index.find(key);
+        if (iter != m_index.end())
+            _erase(iter->second);
+
+        m_bytes += _size(entry);
+        m_entries.emplace_front(key, std::move(entry));
+        m_index[key] = m_entries.begin();
+
+        while (m_bytes > m_max_bytes && !m_entries.empty())
+            _erase(std::prev(m_entries.end()));
+    }
+
+private:
+    static uint64_t _size(const Entry& entry)
+    {
+        return entry.context.size() + entry.output.size();
+    }
+
+    void _erase(Entries::iterator iter)
+    {
+        m_bytes -= _size(iter->second);
+        m_index.erase(iter->first);
+        m_entries.erase(iter);
+    }
+};
+
+struct ServerState
+{
+    const ServeOptions& options;
+    pps::FileCache      files{true};
+    OutputMemo          memo;
+    TemplateMemo        templates;
+    std::atomic<bool>   stopping = false;
+    pps::Engine         engine;
+
+    explicit ServerState(const ServeOptions& options) :
+        options(options), memo(options.memoryBytes), templates(options.memoryBytes)
+    {
+        engine.set_file_cache(&files);
+        engine.set_cache(options.cache);
+    }
+};
+
+static bool readAll(int fd, char* data, size_t size)
+{
+    while (size > 0)
+    {
+        auto count = ::read(fd, data, unsigned(size));
+        if (count <= 0)
+            return false;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        auto count = ::write(fd, data, unsigned(size));
+        if (count <= 0)
+            return false;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool readFrame(int fd, std::string& payload)
+{
+    unsigned char header[4];
+    if (!readAll(fd, reinterpret_cast<char*>(header), sizeof(header)))
+        return false;
+
+    uint32_t size = header[0] | header[1] << 8 | header[2] << 16 | uint32_t(header[3]) << 24;
+    if (size > g_max_frame_size)
+    {
+        ACLG_ERROR("Request of {} bytes exceeds the frame limit.", size);
+        return false;
+    }
+
+    payload.resize(size);
+    return readAll(fd, payload.data(), size);
+}
+
+static bool writeFrame(int fd, const std::string& payload)
+{
+    uint32_t      size      = uint32_t(payload.size());
+    unsigned char header[4] = {uint8_t(size), uint8_t(size >> 8), uint8_t(size >> 16), uint8_t(size >> 24)};
+    return writeAll(fd, reinterpret_cast<const char*>(header), sizeof(header)) && writeAll(fd, payload.data(), payload.size());
+}
+
+static std::string errorResponse(const std::string& message)
+{
+    std::string response(1, char(1));
+    pps::write_blob(response, message);
+    return response;
+}
+
+static std::string handleRequest(ServerState& state, pps::Session& processor, std::string_view request, uint8_t& flags)
+{
+    flags = 0;
+    if (request.size() < 2 || uint8_t(request[0]) != g_protocol_version)
+        return errorResponse("unsupported request version");
+
+    flags = uint8_t(request[1]);
+    request.remove_prefix(2);
+
+    std::string_view source;
+    std::string_view blob;
+    pps::Context     context;
+    if (!pps::read_blob(request, source) || !pps::read_blob(request, blob) || !context.deserialize(blob))
+        return errorResponse("malformed request");
+
+    context.prefixes.insert(state.options.base.prefixes.begin(), state.options.base.prefixes.end());
+
+    std::shared_ptr<const std::string> file;
+    if (flags & ServeSourcePath)
+    {
+        file = state.files.read(std::string(source));
+        if (!file)
+            return errorResponse("could not open " + std::string(source));
+        source = *file;
+    }
+
+    // The serialized form is canonical, so it keys the memo together with the source
+    auto                     canonical = context.serialize();
+    auto                     key       = OutputMemo::key(source, canonical);
+    std::string              output;
+    std::vector<std::string> dependencies;
+    if (!state.memo.lookup(key, canonical, state.files, output, dependencies))
+    {
+        // A failing request is answered with its error; the connection and the server carry on
+        try
+        {
+            auto prepared = state.templates.get(source, state.engine);
+            output        = processor.process(*prepared, &context);
+        }
+        catch (const std::exception& e)
+        {
+            return errorResponse(e.what());
+        }
+        dependencies = processor.dependencies();
+        state.memo.store(key, canonical, state.files, output, dependencies, processor.misses());
+    }
+
+    std::string response(1, char(0));
+    pps::write_blob(response, output);
+    if (flags & ServeDependencies)
+    {
+        pps::write_varint(response, dependencies.size());
+        for (const auto& path : dependencies)
+            pps::write_blob(response, path);
+    }
+    return response;
+}
+
+// Requests of one connection are answered in order by a session owned by the connection
+static void serveConnection(ServerState& state, int in, int out)
+{
+    pps::Session processor(state.engine);
+
+    std::string request;
+    while (readFrame(in, request))
+    {
+        uint8_t flags;
+        auto    response = handleRequest(state, processor, request, flags);
+        if (!writeFrame(out, response))
+            break;
+
+        if (flags & ServeShutdown)
+        {
+            state.stopping = true;
+            break;
+        }
+    }
+}
+
+#if _WIN32
+static int serveSocket(ServerState& state)
+{
+    ACLG_ERROR("Unix sockets are not supported on this platform, serve on stdin/stdout instead.");
+    return 1;
+}
+#else
+static int serveSocket(ServerState& state)
+{
+    const auto& path = state.options.socketPath;
+
+    sockaddr_un address = {};
+    address.sun_family  = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        ACLG_ERROR("Socket path {} is too long.", path);
+        return 1;
+    }
+    path.copy(address.sun_path, path.size());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0)
+    {
+        ACLG_ERROR("Could not listen on {}.", path);
+        if (listener >= 0)
+            ::close(listener);
+        return 1;
+    }
+
+    ACLG_INFO("Serving on {}.", path);
+
+    // Connection threads are detached and counted; the state must outlive the last of them
+    std::mutex              liveMutex;
+    std::condition_variable idle;
+    size_t                  live = 0;
+    while (!state.stopping)
+    {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0)
+            break;
+
+        {
+            std::lock_guard<std::mutex> lock(liveMutex);
+            live++;
+        }
+        std::thread([&state, &liveMutex, &idle, &live, listener, connection]() {
+            serveConnection(state, connection, connection);
+            ::close(connection);
+
+            // Wake the accept loop up so that it sees the shutdown
+            if (state.stopping)
+                ::shutdown(listener, SHUT_RDWR);
+
+            std::lock_guard<std::mutex> lock(liveMutex);
+            live--;
+            idle.notify_all();
+        }).detach();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(liveMutex);
+        idle.wait(lock, [&]() { return live == 0; });
+    }
+
+    ::close(listener);
+    ::unlink(path.c_str());
+    return 0;
+}
+#endif
+
+int runServer(const ServeOptions& options)
+{
+    ServerState state(options);
+
+    if (!options.socketPath.empty())
+    {
+#if !_WIN32
+        // A client closing its connection early must not kill the server
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        return serveSocket(state);
+    }
+
+    // Logs printed to stdout would corrupt the responses, send them to stderr instead
+#if _WIN32
+    _setmode(0, _O_BINARY);
+    _setmode(1, _O_BINARY);
+    int out = _dup(1);
+    _dup2(2, 1);
+#else
+    int out = dup(1);
+    dup2(2, 1);
+#endif
+
+    serveConnection(state, 0, out);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <pps/pps.h>
+#include <pps/cache.h>
+
+#include <string>
+
+// Server protocol, every message is a u32 little-endian payload size followed by the payload.
+// Request:  u8 version (1), u8 flags, varint-prefixed source or path,
+//           varint-prefixed pps::Context::serialize() blob
+// Response: u8 status (0 ok, 1 error), varint-prefixed output or error message,
+//           varint dependency count and varint-prefixed paths (with ServeDependencies)
+enum ServeFlags : uint8_t
+{
+    ServeSourcePath   = 1 << 0, // The source field is a file path
+    ServeDependencies = 1 << 1, // Return the included files of the output
+    ServeShutdown     = 1 << 7, // Stop the server once open connections close
+};
+
+struct ServeOptions
+{
+    std::string  socketPath;          // Unix socket; stdin/stdout when empty
+    pps::Context base;                // Include prefixes added to every request
+    pps::Cache*  cache       = nullptr;
+    uint64_t     memoryBytes = 256ull << 20; // Bound of the in-memory output cache, and apart from it of the template cache
+};
+
+// Serve requests until a shutdown request arrives (or stdin closes)
+int runServer(const ServeOptions& options);
@@ -10,6 +10,24 @@ option("enable_pps_test", function()
     set_description("Enable unit tests for PPS")
 end)
 
+option("enable_pps_bench", function()
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable the PPS benchmark suite")
+end)
+
+option("enable_pps_alloc_tracking", function()
+    set_default(false)
+    set_showmenu(true)
+    set_description("Count allocations per stage in the PPS stats; replaces the global operator new/delete, process-wide on Linux and macOS")
+end)
+
+option("enable_pps_diagnostics", function()
+    set_default(true)
+    set_showmenu(true)
+    set_description("Report warnings and errors of PPS calls; off compiles them out")
+end)
+
 target("libpps", function()
     set_kind("shared")
     add_includedirs("include", {public = true})
@@ -20,13 +38,21 @@ target("libpps", function()
     add_files("src/*.cpp", "src/frontend/*.cpp", "src/pipeline/*.cpp")
     
     add_defines("PPS_EXPORT_DLL")
+    
+    if has_config("enable_pps_alloc_tracking") then
+        add_defines("PPS_TRACK_ALLOCATIONS")
+    end
+    
+    if not has_config("enable_pps_diagnostics") then
+        add_defines("PPS_NO_DIAGNOSTICS")
+    end
 end)
 
 target("pps", function()
     set_kind("binary")
     add_deps("libpps")
     add_includedirs("include", "src/include")
-    add_files("tools/pps.cpp")
+    add_files("tools/*.cpp")
 end)
 
 function add_test_target(name, need_pps, files)
@@ -55,6 +81,23 @@ if has_config("enable_pps_test") then
     add_test_target("pps_generator", false, {"src/frontend/*.cpp", "src/pipeline/*.cpp", "samples/pps_generator.cpp"})
     add_test_target("pps_task_branch", true, {"samples/pps_task_branch.cpp"})
     add_test_target("pps_task_override", true, {"samples/pps_task_override.cpp"})
+    add_test_target("pps_task_permutation", true, {"samples/pps_task_permutation.cpp"})
+    add_test_target("pps_task_specialize", true, {"samples/pps_task_specialize.cpp"})
+    add_test_target("pps_task_incremental", true, {"samples/pps_task_incremental.cpp"})
+    add_test_target("pps_cache", true, {"samples/pps_cache.cpp"})
+    add_test_target("pps_archive", true, {"samples/pps_archive.cpp"})
+    add_test_target("pps_stats", true, {"samples/pps_stats.cpp"})
+    add_test_target("pps_engine", true, {"samples/pps_engine.cpp"})
+    add_test_target("pps_async", true, {"samples/pps_async.cpp"})
+    add_test_target("pps_parallel", true, {"samples/pps_parallel.cpp"})
+    add_test_target("pps_include_once", true, {"samples/pps_include_once.cpp"})
+    add_test_target("pps_include_provider", true, {"samples/pps_include_provider.cpp"})
+    add_test_target("pps_diagnostics", true, {"samples/pps_diagnostics.cpp"})
+    add_test_target("pps_cancel", true, {"samples/pps_cancel.cpp"})
+    add_test_target("pps_process_into", true, {"samples/pps_process_into.cpp"})
+    add_test_target("pps_c_api", true, {"samples/pps_c_api.cpp"})
+    add_test_target("pps_memory", true, {"samples/pps_memory.cpp"})
+    add_test_target("pps_layered_context", true, {"samples/pps_layered_context.cpp"})
     
     target("pps_task_include", function()
         set_kind("binary")
@@ -68,4 +111,20 @@ if has_config("enable_pps_test") then
         add_includedirs("src/include")
         add_files("samples/pps_task_include.cpp")
     end)
+
+    target("pps_serve", function()
+        set_kind("binary")
+        add_deps("libpps")
+        add_includedirs("include", "src/include", "tools")
+        add_files("tools/serve.cpp", "samples/pps_serve.cpp")
+    end)
+end
+
+if has_config("enable_pps_bench") then
+    target("pps_bench", function()
+        set_kind("binary")
+        add_deps("libpps")
+        add_includedirs("include", "src/include")
+        add_files("src/frontend/*.cpp", "src/pipeline/*.cpp", "bench/pps_bench.cpp")
+    end)
 end